@@ -5,6 +5,8 @@
 
 #include "EmbUI.h"
 #include "ui.h"
+#include "wsbuffer.h"
+#include <StreamString.h>
 
 #ifdef EMBUI_DEBUG
  #include "MemoryInfo.h"
@@ -12,9 +14,11 @@
 
 #define MAX_WS_CLIENTS 4
 #define PUB_PERIOD 10000            // Publication period, ms
-#define SECONDARY_PERIOD 300U       // second handler timer, ms
+#define SECONDARY_PERIOD 300U       // second handler timer, ms (LED, config eviction, ws cleanup)
+#define MQTT_RECONNECT_PERIOD 15000U    // MQTT reconnect attempt period, ms
 
 EmbUI embui;
+static WsBufferPool wsbuf;     // сборка фрагментированных ws-сообщений
 
 void section_main_frame(Interface *interf, JsonObject *data) {}
 void pubCallback(Interface *interf){}
@@ -32,17 +36,45 @@ void uploadProgress(size_t len, size_t total){
     }
 }
 
+/**
+ * разбор собранного ws-сообщения
+ * разбор идет на месте: строки документа ссылаются в msg, поэтому буфер должен быть изменяемым
+ */
+static void ws_message(AsyncWebSocketClient *client, char *msg, size_t len, bool binary){
+    METRIC_INC(M_WS_IN_MSGS);
+    JsonDocument &doc = wsbuf.doc();
+    DeserializationError error = binary ? deserializeMsgPack(doc, msg, len) : deserializeJson(doc, msg, len);
+    if (error) {
+        LOG(printf_P, PSTR("UI: ws[%u] message error: %s\n"), client->id(), error.c_str());
+        return;
+    }
+
+    const char *pkg = doc["pkg"];
+    if (!pkg) return;
+    if (!strcmp(pkg, "post")) {
+        JsonObject data = doc["data"];
+        embui.post_async(data);
+    } else
+    if (!strcmp(pkg, "proto")) {
+        // согласование формата, подтверждение уходит уже в новом формате
+        const char *proto = doc["data"];
+        bool bin = proto && !strcmp(proto, "msgpack");
+        embui.ws_binary(client->id(), bin);
+        doc["data"] = bin ? F("msgpack") : F("json");
+        frameSendClient(client).send(doc);
+    }
+}
+
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len){
     if(type == WS_EVT_CONNECT){
+        HEAP_TAG(HEAP_WSCONN);
         LOG(printf_P, PSTR("UI: ws[%s][%u] connect MEM: %u\n"), server->url(), client->id(), ESP.getFreeHeap());
-
-        Interface *interf = new Interface(&embui, client);
-        section_main_frame(interf, nullptr);
-        delete interf;
-
+        embui.ws_connect(client);
     } else
     if(type == WS_EVT_DISCONNECT){
         LOG(printf_P, PSTR("ws[%s][%u] disconnect\n"), server->url(), client->id());
+        embui.ws_binary(client->id(), false);
+        wsbuf.release(client->id());
     } else
     if(type == WS_EVT_ERROR){
         LOG(printf_P, PSTR("ws[%s][%u] error(%u): %s\n"), server->url(), client->id(), *((uint16_t*)arg), (char*)data);
@@ -52,103 +84,230 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
     } else
     if(type == WS_EVT_DATA){
         AwsFrameInfo *info = (AwsFrameInfo*)arg;
-        if(info->final && info->index == 0 && info->len == len){
-            DynamicJsonDocument doc(1024);
-            deserializeJson(doc, data, info->len);
-
-            const char *pkg = doc["pkg"];
-            if (!pkg) return;
-            if (!strcmp(pkg, "post")) {
-                JsonObject data = doc["data"];
-                embui.post(data);
-            }
+        METRIC_ADD(M_WS_IN_BYTES, len);
+        if(info->num == 0 && info->final && info->index == 0 && info->len == len){
+            // сообщение целиком в одном сегменте, разбираем прямо в буфере приема
+            ws_message(client, (char*)data, len, info->opcode == WS_BINARY);
+            return;
         }
+
+        size_t msglen;
+        uint8_t opcode;
+        char *msg = wsbuf.append(client->id(), info, data, len, &msglen, &opcode);
+        if (!msg) return;
+        ws_message(client, msg, msglen, opcode == WS_BINARY);
+        wsbuf.release(client->id());
   }
 }
 
+void EmbUI::ws_binary(uint32_t id, bool on){
+    int slot = -1;
+    for (int i = 0; i < WS_BIN_CLIENTS; i++) {
+        if (wsbin[i] == id) {
+            if (!on) wsbin[i] = 0;
+            return;
+        }
+        if (!wsbin[i] && slot < 0) slot = i;
+    }
+    if (on && slot >= 0) wsbin[slot] = id;
+}
+
+bool EmbUI::ws_isbinary(uint32_t id){
+    if (!id) return false;
+    for (int i = 0; i < WS_BIN_CLIENTS; i++) {
+        if (wsbin[i] == id) return true;
+    }
+    return false;
+}
+
+bool EmbUI::ws_allbinary(){
+    size_t count = 0;
+    for (int i = 0; i < WS_BIN_CLIENTS; i++) {
+        if (wsbin[i]) ++count;
+    }
+    return count && count == ws.count();
+}
+
 void EmbUI::post(JsonObject data){
+    HEAP_TAG(HEAP_POST);
     section_handle_t *section = nullptr;
     int count = 0;
-    Interface *interf = new Interface(this, &ws, 512);
-    interf->json_frame_value();
-
-    for (JsonPair kv : data) {
-        String key = kv.key().c_str(), val = kv.value();
-        if (val != FPSTR(P_null)) {
-            interf->value(key, val);
-            ++count;
-        }
-
-        const char *kname = key.c_str();
-        for (int i = 0; !section && i < section_handle.size(); i++) {
-            const char *sname = section_handle[i]->name.c_str();
-            const char *mall = strchr(sname, '*');
-            unsigned len = mall? mall - sname - 1 : strlen(kname);
-            if (strncmp(sname, kname, len) == 0) {
-                section = section_handle[i];
+    {
+        // эхо значений; буфер возвращается в пул до вызова обработчика секции
+        Interface interf(this, &ws, 512);
+        interf.json_frame_value();
+
+        for (JsonPair kv : data) {
+            String key = kv.key().c_str(), val = kv.value();
+            if (val != FPSTR(P_null)) {
+                interf.value(key, val);
+                ++count;
             }
-        };
-    }
 
-    if (count) {
-        interf->json_frame_flush();
-    } else {
-        interf->json_frame_clear();
+            if (!section) section = section_index.find(key.c_str());
+        }
+
+        if (count) {
+            interf.json_frame_flush();
+        } else {
+            interf.json_frame_clear();
+        }
     }
-    delete interf;
 
     if (section) {
         LOG(printf_P, PSTR("\nUI: POST SECTION: %s\n\n"), section->name.c_str());
-        Interface *interf = new Interface(this, &ws);
-        section->callback(interf, &data);
-        delete interf;
+        Interface interf(this, &ws);
+        METRIC_INC(M_POST_HANDLED);
+        ++section->calls;
+        section->callback(&interf, &data);
     }
 }
 
-void EmbUI::send_pub(){
-    if (!ws.count()) return;
-    Interface *interf = new Interface(this, &ws, 512);
-    pubCallback(interf);
-    delete interf;
+void EmbUI::ws_connect(AsyncWebSocketClient *client){
+    // интерфейс строится только из handle(), клиент, которому не хватило места, переподключится сам
+    if (!postq.push_connect(client->id())) client->close();
 }
 
-void EmbUI::var(const String &key, const String &value, bool force)
-{
-    // JsonObject of N element	8 + 16 * N
-    unsigned len = key.length() + value.length() + 16;
-    size_t cap = cfg.capacity(), mem = cfg.memoryUsage();
+void EmbUI::ws_main_frame(AsyncWebSocketClient *client){
+    autoSaveReset();    // автосохранение отсчитывается от открытия интерфейса, построители из кэша не вызываются
+#ifdef EMBUI_FRAMECACHE
+    if (framecache.replay(F("main"), client)) return;
 
-    LOG(printf_P, PSTR("UI WRITE: key (%s) value (%s) "), key.c_str(), value.substring(0, 15).c_str());
-    if (!force && !cfg.containsKey(key)) {
-        LOG(printf_P, PSTR("UI ERROR: KEY (%s) is NOT initialized!\n"), key.c_str());
-        return;
+    framecache.begin(F("main"));
+    {
+        Interface interf(this, client, &framecache);
+        section_main_frame(&interf, nullptr);
+    }
+    framecache.end();
+#else
+    Interface interf(this, client);
+    section_main_frame(&interf, nullptr);
+#endif
+}
+
+void EmbUI::post_async(JsonObject data){
+    if (!postq.push(data)) LOG(println, F("UI: post queue full, post dropped"));
+}
+
+void EmbUI::post_drain(){
+    if (!postq.pending()) return;
+
+    for (uint32_t id = postq.pop_connect(); id; id = postq.pop_connect()) {
+        AsyncWebSocketClient *client = ws.client(id);
+        if (!client || client->status() != WS_CONNECTED) continue;
+        pub_reset();    // новый клиент получит полный снимок значений в следующей публикации
+        ws_main_frame(client);
     }
 
-    if (cap - mem < len) {
-        cfg.garbageCollect();
-        LOG(printf_P, PSTR("UI: garbage cfg %u(%u) of %u\n"), mem, cfg.memoryUsage(), cap);
+    // пока идет интервал, пакеты копятся и схлопываются, по его окончании колесо само вызовет post_batch()
+    if (postq.size() && !tpostq.active()) post_batch();
+}
+
+// буфер пакета и документ для его разбора: на стеке cont (4 КБ) под них нет места, а разбор идет только из loop()
+static char postq_buf[EMBUI_POSTQ_SLOT];
+static StaticJsonDocument<JSON_OBJECT_SIZE(EMBUI_POSTQ_SLOT / 6)> postq_doc;
+static bool postq_busy = false;     // обработчик секции вызвал handle(): буферы заняты, очередь подождет
+
+/**
+ * разобрать очередь post в пределах EMBUI_POSTQ_BUDGET и отсчитать интервал до следующего разбора
+ */
+void EmbUI::post_batch(){
+    if (postq_busy) return;
+    postq_busy = true;
+    tpostq.once(EMBUI_POSTQ_PERIOD, [this](){ if (postq.size()) post_batch(); });
+    unsigned long start = millis();
+
+    do {
+        char *msg = postq.pop(postq_buf, sizeof(postq_buf));
+        if (!msg) break;
+
+        // разбор на месте, строки ссылаются в msg
+        unsigned long us = micros();
+        bool ok;
+        if (msg == postq_buf) {
+            ok = !deserializeJson(postq_doc, msg);
+            if (ok) post(postq_doc.as<JsonObject>());
+        } else {
+            // пакет из запаса длиннее слота, документ под его длину
+            DynamicJsonDocument doc(JSON_OBJECT_SIZE(strlen(msg) / 6 + 1));
+            ok = !deserializeJson(doc, msg);
+            if (ok) post(doc.as<JsonObject>());
+            free(msg);
+        }
+        if (!ok) continue;
+        postq.done(micros() - us);
+        LOG(printf_P, PSTR("UI: post queue depth %u, handler %lu us\n"), postq.size(), micros() - us);
+    } while (millis() - start < EMBUI_POSTQ_BUDGET);
+    postq_busy = false;
+}
+
+bool EmbUI::pub_changed(const String &id, const String &value, bool html, bool track){
+    uint32_t h = embui_hash(id.c_str()) | 1;    // 0 зарезервирован под свободный слот
+    uint32_t v = embui_hash(value.c_str()) ^ html;
+    pub_slot_t *slot = nullptr, *old = &pubslot[0];
 
+    for (int i = 0; i < EMBUI_PUB_SLOTS; i++) {
+        if (pubslot[i].id == h) {
+            slot = &pubslot[i];
+            break;
+        }
+        if (!slot && !pubslot[i].id) slot = &pubslot[i];
+        if (pubslot[i].used < old->used) old = &pubslot[i];
     }
-    if (cap - mem < len) {
-        LOG(printf_P, PSTR("UI ERROR: KEY (%s) NOT WRITE !!!!!!!!\n"), key.c_str());
+    if (!slot) {
+        if (!track) return true;    // разовая рассылка не вытесняет публикуемые значения
+        slot = old;
+        METRIC_INC(M_PUB_EVICT);
+    }
+    if (slot->id != h && !track) return true;
+
+    bool changed = slot->id != h || slot->val != v;
+    slot->id = h;
+    slot->val = v;
+    slot->used = ++pubtick;
+    return changed;
+}
+
+void EmbUI::send_pub(){
+    if (!ws.count()) return;
+    Interface interf(this, &ws, 512);
+    interf.json_frame_delta();
+    pubCallback(&interf);
+}
+
+void EmbUI::var(const cfgkey_t &key, const String &value, bool force)
+{
+    ConfigStore::cfg_slot_t *s = cfg.find(key);
+
+    LOG(printf_P, PSTR("UI WRITE: key (%s) value (%s) "), key.pgm ? String(FPSTR(key.p)).c_str() : key.p, value.substring(0, 15).c_str());
+    if (!s && force) s = cfg.create(key, nullptr);
+    if (!s) {
+        LOG(println, F("UI ERROR: KEY is NOT initialized!"));
         return;
     }
 
-    cfg[key] = value;
-    sysData.isNeedSave = true;
+    char *old = nullptr;
+    bool watched = cfgobs.watched(s);
+    if (cfg.set(s, value.c_str(), watched ? &old : nullptr)) {
+        framecache.changed(s->hash);
+        sysData.isNeedSave = true;
+        autosave_arm();
+        if (watched) cfgobs.changed(cfg, s, old);
+    }
 
-    LOG(printf_P, PSTR("UI FREE: %u\n"), cap - cfg.memoryUsage());
+    LOG(printf_P, PSTR("UI CFG: %u keys, %u bytes\n"), cfg.size(), cfg.memory());
 
     // if (mqtt_remotecontrol) {
     //     publish(String(F("embui/set/")) + key, value, true);
     // }
 }
 
-void EmbUI::var_create(const String &key, const String &value)
+void EmbUI::var_create(const cfgkey_t &key, const String &value, cfg_type_t type)
 {
-    if(cfg[key].isNull()){
-        cfg[key] = value;
-        LOG(printf_P, PSTR("UI CREATE key: (%s) value: (%s) RAM: %d\n"), key.c_str(), value.substring(0, 15).c_str(), ESP.getFreeHeap());
+    // без find(): значение по-умолчанию не должно подгружать пространство имен ключа
+    uint16_t n = cfg.size();
+    if (cfg.create(key, value.c_str(), type) && cfg.size() != n){
+        LOG(printf_P, PSTR("UI CREATE key: (%s) value: (%s) RAM: %d\n"), key.pgm ? String(FPSTR(key.p)).c_str() : key.p, value.substring(0, 15).c_str(), ESP.getFreeHeap());
     }
 }
 
@@ -157,7 +316,9 @@ void EmbUI::section_handle_add(const String &name, buttonCallback response)
     section_handle_t *section = new section_handle_t;
     section->name = name;
     section->callback = response;
+    section->calls = 0;
     section_handle.add(section);
+    section_index.add(section);
 
     LOG(printf_P, PSTR("UI REGISTER: %s\n"), name.c_str());
 }
@@ -168,7 +329,7 @@ void EmbUI::section_handle_add(const String &name, buttonCallback response)
  */
 const char* EmbUI::param(const char* key)
 {
-    const char* value = cfg[key];
+    const char* value = param<const char*>(key);
     if (value){
         LOG(printf_P, PSTR("UI READ: key (%s) value (%s)\n"), key, value);
     }
@@ -186,10 +347,16 @@ String EmbUI::param(const String &key)
     return value;
 }
 
+String EmbUI::param(const __FlashStringHelper *key)
+{
+    String value(param<const char*>(key));
+    return value;
+}
+
 String EmbUI::deb()
 {
-    String cfg_str;
-    serializeJson(cfg, cfg_str);
+    StreamString cfg_str;
+    cfg.printTo(cfg_str);
     return cfg_str;
 }
 
@@ -198,7 +365,9 @@ void notFound(AsyncWebServerRequest *request) {
 }
 
 void EmbUI::init(){
+    unsigned long t = micros();
     load();
+    LOG(printf_P, PSTR("UI BOOT: config load %lu us\n"), micros() - t);
     LOG(println, String(F("UI CONFIG: ")) + embui.deb());
     #ifdef ESP8266
         e1 = WiFi.onStationModeGotIP(std::bind(&EmbUI::onSTAGotIP, this, std::placeholders::_1));
@@ -211,12 +380,31 @@ void EmbUI::init(){
     // восстанавливаем настройки времени
     timeProcessor.tzsetup(param(FPSTR(P_TZSET)).c_str());
     timeProcessor.setcustomntp(param(FPSTR(P_userntp)).c_str());
+
+    // дальше время и MQTT сами следят за своими ключами
+    observe(FPSTR(P_TZSET), [](const char *key, const char *oldval, const char *newval){ embui.timeProcessor.tzsetup(newval); });
+    observe(FPSTR(P_userntp), [](const char *key, const char *oldval, const char *newval){ embui.timeProcessor.setcustomntp(newval); });
+    observe(F("m_"), [](const char *key, const char *oldval, const char *newval){ embui.mqtt_reconf(); }, true);
 }
 
 void EmbUI::begin(){
+    framepool.begin();      // буферы фреймов резервируются, пока куча еще не раздроблена
     ws.onEvent(onWsEvent);
     server.addHandler(&ws);
 
+    tbtn.every(EMBUI_BTN_POLL, [this](){ PROF_CALL(PROF_BTN, btn()); });
+    tsecondary.every(SECONDARY_PERIOD, [this](){
+        PROF_CALL(PROF_LED, led_handle());
+        cfg_evict();
+        PROF_CALL(PROF_CLEANUP, ws.cleanupClients(MAX_WS_CLIENTS));
+    });
+    tpub.every(PUB_PERIOD, [this](){ PROF_CALL(PROF_PUB, send_pub()); });
+    heapmon.begin();
+    tmqtt.every(MQTT_RECONNECT_PERIOD, [this](){
+        const char *host = cfg.get<const char*>(FPSTR(P_m_host));
+        if (host && *host) mqtt_reconnect();
+    });
+
 #ifdef USE_SSDP
     ssdp_begin(); LOG(println, F("Start SSDP"));
 #endif
@@ -284,12 +472,101 @@ void EmbUI::begin(){
         request->send(200, FPSTR(PGmimetxt), F("Ok"));
     });
 
+#ifdef EMBUI_PROFILER
+    // время этапов handle(), /prof?reset обнуляет статистику
+    server.on(PSTR("/prof"), HTTP_GET, [this](AsyncWebServerRequest *request){
+        AsyncResponseStream *response = request->beginResponseStream(FPSTR(PGmimetxt));
+        profiler.printTo(*response);
+        if (request->hasParam(F("reset"))) profiler.reset();
+        request->send(response);
+    });
+#endif
+
+#ifdef EMBUI_ALLOCTRACE
+    // места выделения памяти: /alloc?by=live|peak|bytes|count&top=N, /alloc?reset обнуляет счетчики
+    server.on(PSTR("/alloc"), HTTP_GET, [this](AsyncWebServerRequest *request){
+        uint8_t by = AllocTrace::AT_BY_LIVE;
+        if (request->hasParam(F("by"))) {
+            const String &v = request->getParam(F("by"))->value();
+            if (v == F("peak")) by = AllocTrace::AT_BY_PEAK;
+            else if (v == F("bytes")) by = AllocTrace::AT_BY_BYTES;
+            else if (v == F("count")) by = AllocTrace::AT_BY_COUNT;
+        }
+        uint8_t top = request->hasParam(F("top")) ? constrain(request->getParam(F("top"))->value().toInt(), 1, EMBUI_ALLOCTRACE_SITES) : 20;
+
+        AsyncResponseStream *response = request->beginResponseStream(FPSTR(PGmimetxt));
+        alloctrace.printTo(*response, top, by);
+        if (request->hasParam(F("reset"))) alloctrace.reset();
+        request->send(response);
+    });
+#endif
+
+    // счетчики и текущие значения в формате Prometheus, пишутся прямо в поток ответа
+    server.on(PSTR("/metrics"), HTTP_GET, [this](AsyncWebServerRequest *request){
+        AsyncResponseStream *response = request->beginResponseStream(F("text/plain; version=0.0.4"));
+        metrics.printTo(*response);
+
+        static const char gauge[] PROGMEM = "gauge";
+        Metrics::print(*response, PSTR("embui_uptime_seconds"), PSTR("Time since boot"), gauge, millis() / 1000);
+        Metrics::print(*response, PSTR("embui_heap_free_bytes"), PSTR("Free heap"), gauge, ESP.getFreeHeap());
+#ifdef ESP8266
+        Metrics::print(*response, PSTR("embui_heap_max_block_bytes"), PSTR("Largest allocatable block"), gauge, ESP.getMaxFreeBlockSize());
+        Metrics::print(*response, PSTR("embui_heap_fragmentation_percent"), PSTR("Heap fragmentation"), gauge, ESP.getHeapFragmentation());
+#else
+        Metrics::print(*response, PSTR("embui_heap_max_block_bytes"), PSTR("Largest allocatable block"), gauge, ESP.getMaxAllocHeap());
+#endif
+        Metrics::print(*response, PSTR("embui_ws_clients"), PSTR("Connected WebSocket clients"), gauge, ws.count());
+        Metrics::print(*response, PSTR("embui_config_keys"), PSTR("Config keys in RAM"), gauge, cfg.size());
+        Metrics::print(*response, PSTR("embui_config_bytes"), PSTR("Config memory"), gauge, cfg.memory());
+        Metrics::print(*response, PSTR("embui_postq_spilled_total"), PSTR("Posts that did not fit a queue slot and waited on the heap"), PSTR("counter"), postq.stats().spilled);
+        Metrics::print(*response, PSTR("embui_postq_overflow_total"), PSTR("Posts dropped, queue and spill list full"), PSTR("counter"), postq.stats().overflow);
+        Metrics::print(*response, PSTR("embui_ui_pool_hits_total"), PSTR("UI frame buffers leased from the pool"), PSTR("counter"), framepool.stats().hits);
+        Metrics::print(*response, PSTR("embui_ui_pool_misses_total"), PSTR("UI frame buffers allocated from the heap, pool busy or too small"), PSTR("counter"), framepool.stats().misses);
+
+        for (int i = 0; i < section_handle.size(); i++) {
+            Metrics::print(*response, PSTR("embui_section_calls_total"), i ? nullptr : PSTR("Section handler invocations per section"),
+                i ? nullptr : PSTR("counter"), section_handle[i]->calls, PSTR("section"), section_handle[i]->name.c_str());
+        }
+        request->send(response);
+    });
+
+    // замеры кучи из кольцевого буфера монитора
+    server.on(PSTR("/heap.json"), HTTP_GET, [this](AsyncWebServerRequest *request){
+        AsyncResponseStream *response = request->beginResponseStream(FPSTR(PGmimejson));
+        response->addHeader(FPSTR(PGhdrcachec), FPSTR(PGnocache));
+        heapmon.printTo(*response);
+        request->send(response);
+    });
+
+    server.on(PSTR("/heap.svg"), HTTP_GET, [this](AsyncWebServerRequest *request){
+        AsyncResponseStream *response = request->beginResponseStream(F("image/svg+xml"));
+        response->addHeader(FPSTR(PGhdrcachec), FPSTR(PGnocache));
+        heapmon.printSvg(*response);
+        request->send(response);
+    });
+
     server.on(PSTR("/heap"), HTTP_GET, [this](AsyncWebServerRequest *request){
         String out = "Heap: "+String(ESP.getFreeHeap());
 #ifdef EMBUI_DEBUG
         out += "\nFrac: " + String(getFragmentation());
         out += "\nClient: " + String(ws.count());
 #endif
+        const PostQueue::postq_stat_t &pq = postq.stats();
+        out += "\nPostQ: " + String(postq.size()) + "/" + String(pq.depth_max) + " of " + String(EMBUI_POSTQ_DEPTH);
+        out += "\nPostQ queued/merged/spilled/dropped: " + String(pq.queued) + "/" + String(pq.merged) + "/" + String(pq.spilled) + "/" + String(pq.overflow);
+        out += "\nPostQ handler us avg/max: " + String(pq.processed ? pq.lat_sum / pq.processed : 0) + "/" + String(pq.lat_max);
+        const FramePool::framepool_stat_t &fp = framepool.stats();
+        out += "\nUI pool hit/miss/peak: " + String(fp.hits) + "/" + String(fp.misses) + "/" + String(fp.peak) + " of " + String(EMBUI_FRAMEPOOL_SLOTS);
+        out += "\nCfg keys/bytes: " + String(cfg.size()) + "/" + String(cfg.memory());
+        out += "\nCfg pages/live/garbage: " + String(cfg.arena().pagecount()) + "/" + String(cfg.arena().live()) + "/" + String(cfg.arena().garbage());
+        out += "\nCfg shards:";
+        for (uint8_t i = 1; cfg.shard(i); i++) {
+            const ConfigStore::cfg_shard_t *sh = cfg.shard(i);
+            out += " " + String(sh->name) + (sh->loaded ? (sh->dirty ? "*" : "+") : "-");
+        }
+        out += "\nCfg save loop ms <1..>=64:";
+        for (uint8_t i = 0; i < CFG_LOOP_HIST; i++) out += " " + String(cfgw.loop_hist()[i]);
+        out += "\nCfg save loop max us: " + String(cfgw.loop_maxtime());
         request->send(200, FPSTR(PGmimetxt), out);
     });
 
@@ -384,30 +661,35 @@ void EmbUI::led(uint8_t pin, bool invert){
 }
 
 void EmbUI::handle(){
-    if (sysData.shouldReboot) {
+    PROF(PROF_LOOP);
+    // время итерации loop() пока идет запись конфига
+    static unsigned long loop_us = 0;
+    unsigned long now_us = micros();
+    if (cfgw.busy()) cfgw.loop_time(now_us - loop_us);
+    loop_us = now_us;
+    PROF_CALL(PROF_PERSIST, cfg_persist());
+
+    // перезагрузка ждет всю фоновую запись: снимок (вместе с /config.bin) или журнал, отложенное сохранение, файлы пространств имен
+    if (sysData.shouldReboot && !cfgw.busy() && !sysData.cfg_queued && !sysData.cfg_shards) {
         LOG(println, F("Rebooting..."));
         delay(100);
         ESP.restart();
     }
 #ifdef ESP8266
-    MDNS.update();
+    PROF_CALL(PROF_MDNS, MDNS.update());
 #endif
     //_connected();
-    mqtt_handle();
-    udpLoop();
-
-    static unsigned long timer = 0;
-    if (timer + SECONDARY_PERIOD > millis()) return;
-    timer = millis();
-
-    btn();
-    led_handle();
-    autosave();
-    ws.cleanupClients(MAX_WS_CLIENTS);
-
-    //публикация изменяющихся значений
-    static unsigned long timer_pub = 0;
-    if (timer_pub + PUB_PERIOD > millis()) return;
-    timer_pub = millis();
-    send_pub();
+    PROF_CALL(PROF_MQTT, mqtt_handle());
+    PROF_CALL(PROF_UDP, udpLoop());
+    PROF_CALL(PROF_POST, post_drain());
+    PROF_CALL(PROF_OBSERVERS, cfgobs.dispatch(cfg));
+    PROF_CALL(PROF_TIMERS, timerwheel.run());
+}
+
+uint32_t EmbUI::idle() const {
+    // работа, которая делается на каждом проходе, а не по таймеру
+    if (cfgw.busy() || sysData.cfg_queued || sysData.cfg_shards) return 0;
+    if (postq.connecting() || cfgobs.pending() || sysData.mqtt_connect || sysData.shouldReboot) return 0;
+    if (postq.size() && !tpostq.active()) return 0;     // иначе очередь разберет таймер
+    return timerwheel.next();
 }
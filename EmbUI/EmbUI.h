@@ -34,18 +34,28 @@
  #endif
 #endif
 
-#include <Ticker.h>   // esp планировщик
 
 #include <AsyncMqttClient.h>
 #include "LList.h"
+#include "sectionindex.h"
+#include "postqueue.h"
+#include "timerwheel.h"     // планировщик
+#include "gpio.h"
+#include "profiler.h"
+#include "metrics.h"
+#include "heapmon.h"
+#include "alloctrace.h"
 
 #include "timeProcessor.h"
+#include "framecache.h"
+#include "framepool.h"
+#include "config.h"
 
 #define AUTOSAVE_TIMEOUT    15      // configuration autosave timer, sec    (4 bit value)
 #define UDP_PORT            4243    // UDP server port
 
 #ifndef DELAY_AFTER_FS_WRITING
-#define DELAY_AFTER_FS_WRITING       (50U)                        // 50мс, меньшие значения могут повлиять на стабильность
+#define DELAY_AFTER_FS_WRITING       (50U)                        // не используется: конфиг пишется в фоне из handle()
 #endif
 
 #ifndef __DISABLE_BUTTON0
@@ -57,7 +67,13 @@
 #endif
 
 #ifndef __CFGSIZE
-#define __CFGSIZE (2048)
+#define __CFGSIZE (2048)        // документ для разбора /config.json при загрузке
+#endif
+
+#define WS_BIN_CLIENTS      8       // сколько ws-клиентов может одновременно работать в MessagePack
+
+#ifndef EMBUI_PUB_SLOTS
+#define EMBUI_PUB_SLOTS     16      // сколько id отслеживается для публикации только изменившихся значений
 #endif
 
 
@@ -77,35 +93,38 @@ class Interface;
     obj.clear(); \
 }
 
+// Interface создается на стеке, без клиентов обработчик вызывается с nullptr
 #define CALL_INTF(key, val, call) { \
     obj[key] = val; \
-    Interface *interf = embui.ws.count()? new Interface(&embui, &embui.ws, 1000) : nullptr; \
-    call(interf, &obj); \
-    if (interf) { \
-        interf->json_frame_value(); \
-        interf->value(key, val, false); \
-        interf->json_frame_flush(); \
-        delete interf; \
-    } \
+    if (embui.ws.count()) { \
+        Interface interf(&embui, &embui.ws, 1000); \
+        call(&interf, &obj); \
+        interf.json_frame_value(); \
+        interf.value(key, val, false); \
+        interf.json_frame_flush(); \
+    } else call(nullptr, &obj); \
 }
 
 #define CALL_INTF_OBJ(call) { \
-    Interface *interf = embui.ws.count()? new Interface(&embui, &embui.ws, 1000) : nullptr; \
-    call(interf, &obj); \
-    if (interf) { \
-        interf->json_frame_value(); \
+    if (embui.ws.count()) { \
+        Interface interf(&embui, &embui.ws, 1000); \
+        call(&interf, &obj); \
+        interf.json_frame_value(); \
         for (JsonPair kv : obj) { \
-            interf->value(kv.key().c_str(), kv.value(), false); \
+            interf.value(kv.key().c_str(), kv.value(), false); \
         } \
-        interf->json_frame_flush(); \
-        delete interf; \
-    } \
+        interf.json_frame_flush(); \
+    } else call(nullptr, &obj); \
 }
 
 void __attribute__((weak)) section_main_frame(Interface *interf, JsonObject *data);
 void __attribute__((weak)) pubCallback(Interface *interf);
 String __attribute__((weak)) httpCallback(const String &param, const String &value, bool isset);
 void __attribute__((weak)) uploadProgress(size_t len, size_t total);
+/**
+ * события кнопки (btn_event_t), true - событие обработано, действие фреймворка не выполняется
+ */
+bool __attribute__((weak)) btnCallback(uint8_t event);
 
 //----------------------
 
@@ -142,6 +161,12 @@ class EmbUI
         bool shouldReboot:1; // OTA update reboot flag
         uint8_t LED_PIN:5; // [0...30]
         uint8_t asave:4; // зачем так часто записывать конфиг? Ставлю раз в 15 секунд, вместо раза в секунду [0...15]
+        bool cfg_compact:1; // журнал конфига нужно свернуть в снимок при следующем сохранении
+        bool cfg_shards:1;  // после основного конфига записать измененные пространства имен
+        bool btn_wifi:1;    // кнопка удерживалась 5 секунд, режим WiFi применяется при отпускании
+        bool cfg_queued:1;  // save() пришелся на идущую запись и ждет ее окончания
+        bool cfg_qmain:1;   // в очереди сохранение основного конфига
+        bool fs_mounted:1;  // LittleFS смонтирована, см. fs_begin()
     };
     uint32_t flags; // набор битов для конфига
     _BITFIELDS() {
@@ -155,48 +180,101 @@ class EmbUI
         shouldReboot = false; // OTA update reboot flag
         LED_PIN = 31; // [0...30]
         asave = AUTOSAVE_TIMEOUT; // зачем так часто записывать конфиг? Ставлю раз в 13 секунд, вместо раза в секунду [0...15]
+        cfg_compact = false;
+        cfg_shards = false;
+        btn_wifi = false;
+        cfg_queued = false;
+        cfg_qmain = false;
+        fs_mounted = false;
     }
     } BITFIELDS;
     #pragma pack(pop)
 
+    typedef struct pub_slot_t {
+      uint32_t id;      // хэш id элемента, 0 - свободный слот
+      uint32_t val;     // хэш последнего разосланного значения
+      uint32_t used;    // номер последнего обращения, при заполненной таблице вытесняется самый старый
+    } pub_slot_t;
+
     typedef void (*buttonCallback) (Interface *interf, JsonObject *data);
     typedef void (*mqttCallback) ();
+    typedef void (*cfgSaveCallback) (bool ok);
+
+    // что пишет текущее фоновое сохранение
+    typedef enum : uint8_t {
+      CFG_SAVE_JOURNAL = 0,
+      CFG_SAVE_SNAPSHOT,
+      CFG_SAVE_COPY,
+      CFG_SAVE_SHARD
+    } cfg_save_t;
 
     typedef struct section_handle_t{
       String name;
       buttonCallback callback;
+      uint32_t calls;       // вызовов обработчика, для /metrics
     } section_handle_t;
 
-    DynamicJsonDocument cfg;
+    ConfigStore cfg;
     LList<section_handle_t*> section_handle;
+    SectionIndex<section_handle_t*> section_index;     // поиск обработчика по ключу из post
     AsyncMqttClient mqttClient;
 
   public:
-    EmbUI() : cfg(__CFGSIZE), section_handle(), server(80), ws("/ws"){
+    EmbUI() : cfg(), section_handle(), server(80), ws("/ws"){
       *mc='\0';
+      memset(wsbin, 0, sizeof(wsbin));
+      pub_reset();
     }
     BITFIELDS sysData;
     AsyncWebServer server;
     AsyncWebSocket ws;
     mqttCallback onConnect;
     TimeProcessor timeProcessor;
+    FrameCache framecache;      // кэш фреймов главной секции для новых ws-клиентов (EMBUI_FRAMECACHE)
 
     char mc[13]; // id из mac-адреса "ffffffffffff"
 
-    void var(const String &key, const String &value, bool force = false);
-    void var_create(const String &key, const String &value);
+    void var(const cfgkey_t &key, const String &value, bool force = false);
+    /**
+     * создать ключ со значением по-умолчанию
+     * type = CFG_INT/CFG_FLOAT - значение хранится еще и разобранным, param<int>()/param<float>() не разбирают строку
+     */
+    void var_create(const cfgkey_t &key, const String &value, cfg_type_t type = CFG_STR);
     void section_handle_add(const String &btn, buttonCallback response);
     const char* param(const char* key);
     String param(const String &key);
-    bool isparamexists(const char* key){ return cfg.containsKey(key);}
-    bool isparamexists(const String &key){ return cfg.containsKey(key);}
+    String param(const __FlashStringHelper *key);
+
+    /**
+     * значение параметра в нужном типе без выделения памяти: param<int>(FPSTR(P_m_port)), param<bool>(...), param<const char*>(...)
+     * для отсутствующего ключа возвращает 0/false/nullptr
+     * указатель param<const char*>() действителен до следующего var(): строки конфига могут переезжать
+     */
+    template<typename T> T param(const cfgkey_t &key){
+        ConfigStore::cfg_slot_t *s = cfg.find(key);
+        framecache.depend(s ? s->hash : key.hash());
+        return ConfigStore::as<T>(s);
+    }
+
+    bool isparamexists(const cfgkey_t &key){ return cfg.find(key);}
+
+    /**
+     * вызывать cb при изменении ключа (или любого ключа с префиксом key, если prefix) через var()
+     * вызовы идут из handle() пачкой, со старым и новым значением; ключ должен быть PROGMEM-константой или литералом
+     */
+    bool observe(const cfgkey_t &key, cfgObserver cb, bool prefix = false){ return cfgobs.add(key, cb, prefix); }
     void led(uint8_t pin, bool invert);
     String deb();
     void init();
     void begin();
     void handle();
-    void autoSaveReset() {astimer = millis();} // передвинуть таймер
-    void save(const char *_cfg = nullptr, bool force = false);
+    /**
+     * через сколько мс у handle() появится работа: loop() может спать это время (delay() отдает время WiFi)
+     */
+    uint32_t idle() const;
+    void autoSaveReset() { if (tasave.active()) autosave_arm(true); } // отсчитывать автосохранение заново от этого момента
+    void save(const char *_cfg = nullptr, bool force = false, cfgSaveCallback cb = nullptr);
+    bool saving() const { return cfgw.busy() || sysData.cfg_queued; }     // идет фоновая запись конфига
     void load(const char *_cfg = nullptr);
     void udp(const String &message);
     void udp();
@@ -220,7 +298,33 @@ class EmbUI
      */
     void wifi_connect(const char *ssid=nullptr, const char *pwd=nullptr);
     void post(JsonObject data);
+    /**
+     * отложенная обработка ws-событий: post и построение интерфейса для нового клиента
+     * выполняются в handle(), а не в контексте async_tcp. Значения "directly"-контролов схлопываются,
+     * пакеты, не поместившиеся в слоты, ждут в куче, при переполненном запасе отбрасываются;
+     * новый клиент, которому не хватило места, отключается и переподключается сам
+     */
+    void post_async(JsonObject data);
+    void ws_connect(AsyncWebSocketClient *client);
     void send_pub();
+
+    /**
+     * формат обмена ws-клиента: MessagePack (binary) или JSON (text)
+     * клиент запрашивает MessagePack пакетом {"pkg":"proto","data":"msgpack"} после подключения
+     */
+    void ws_binary(uint32_t id, bool on);
+    bool ws_isbinary(uint32_t id);
+    bool ws_allbinary();
+
+    /**
+     * таблица значений, разосланных всем клиентам
+     * pub_changed() сравнивает значение с последним разосланным и запоминает новое;
+     * новый id занимает слот только при track (публикация send_pub()), остальные рассылки лишь обновляют
+     * уже отслеживаемые значения, при заполненной таблице вытесняется id, к которому дольше всего не обращались
+     * pub_reset() забывает все значения, следующая публикация уйдет полным снимком
+     */
+    bool pub_changed(const String &id, const String &value, bool html, bool track);
+    void pub_reset(){ memset(pubslot, 0, sizeof(pubslot)); pubtick = 0; }
     String id(const String &tpoic);
 
   private:
@@ -229,12 +333,27 @@ class EmbUI
     void led_off();
     void led_inv();
     void autosave();
+    void autosave_arm(bool reset = false);
+    void cfg_persist();
+    bool fs_begin();
+    void save_done(bool ok);
+    void save_queue(const char *_cfg, bool force, cfgSaveCallback cb);
+    void save_next();
+    bool cfg_loadbin();
+    void cfg_writeshard();
+    void cfg_evict();
+    void cfg_erase();
+    void load_journal();
+    void post_drain();
+    void post_batch();
+    void ws_main_frame(AsyncWebSocketClient *client);
     void udpBegin();
     void udpLoop();
     void btn();
     void getAPmac();
     void pub_mqtt(const String &key, const String &value);
     void mqtt_handle();
+    void mqtt_reconf();
     void subscribeAll(bool isOnlyGetSet=true);
 
     /**
@@ -249,7 +368,7 @@ class EmbUI
     void onSTAGotIP(WiFiEventStationModeGotIP ipInfo);
     void onSTADisconnected(WiFiEventStationModeDisconnected event_info);
     void setup_mDns();
-    Ticker embuischedw;        // планировщик WiFi
+    TwTimer embuischedw;        // планировщик WiFi
 
     static void onMqttDisconnect(AsyncMqttClientDisconnectReason reason);
     static void onMqttSubscribe(uint16_t packetId, uint8_t qos);
@@ -262,7 +381,25 @@ class EmbUI
     //char udpRemoteIP[16];
     String incomingPacket;
     String udpMessage; // буфер для сообщений Обмена по UDP
-    unsigned long astimer;
+    uint32_t wsbin[WS_BIN_CLIENTS];     // id клиентов, работающих в MessagePack
+    pub_slot_t pubslot[EMBUI_PUB_SLOTS];
+    uint32_t pubtick = 0;
+    PostQueue postq;
+    TwTimer tpostq;                     // интервал между разборами очереди post
+    TwTimer tsecondary;                 // светодиод, вытеснение конфига, очистка ws-клиентов
+    TwTimer tasave;                     // автосохранение, заводится первым изменением конфига
+    TwTimer tpub;                       // публикация изменяющихся значений
+    TwTimer tmqtt;                      // переподключение к MQTT
+    TwTimer tbtn;                       // опрос кнопки
+    Button button;
+    CfgWriter cfgw;                     // фоновая запись конфига
+    CfgObservers cfgobs;                // наблюдатели за изменениями конфига
+    String mqtt_host, mqtt_user, mqtt_pass;     // AsyncMqttClient держит указатели на эти строки
+    cfgSaveCallback save_cb = nullptr;
+    cfgSaveCallback save_qcb = nullptr;     // колбэк сохранения, ждущего в очереди
+    String save_qpath;                      // копия конфига, ждущая в очереди
+    cfg_save_t save_mode = CFG_SAVE_JOURNAL;
+    uint8_t save_shard = 0;         // пространство имен, которое пишется сейчас
 
 #ifdef USE_SSDP
     void ssdp_begin() {
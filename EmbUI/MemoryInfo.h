@@ -12,6 +12,9 @@ size_t getTotalAvailableMemory();
 // Returns the size of the largest allocable block of RAM.
 size_t getLargestAvailableBlock();
 
+// Fills both values at once, walking the heap a single time where the port allows it.
+void getMemoryInfo(size_t &total, size_t &largest);
+
 // Computes the heap fragmentation percentage.
 inline float getFragmentation() {
   return 100 - getLargestAvailableBlock() * 100.0 / getTotalAvailableMemory();
@@ -57,3 +57,8 @@ size_t getLargestAvailableBlock() {
   }
   return largest;
 }
+
+void getMemoryInfo(size_t &total, size_t &largest) {
+  total = getTotalAvailableMemory();
+  largest = getLargestAvailableBlock();
+}
@@ -0,0 +1,21 @@
+// C++ for Arduino
+// What is heap fragmentation?
+// https://cpp4arduino.com/
+
+// This source file captures the platform dependent code.
+// The ESP-IDF heap keeps its own statistics, only the byte-addressable heap is counted.
+
+#include <esp_heap_caps.h>
+
+size_t getTotalAvailableMemory() {
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+size_t getLargestAvailableBlock() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+void getMemoryInfo(size_t &total, size_t &largest) {
+  total = getTotalAvailableMemory();
+  largest = getLargestAvailableBlock();
+}
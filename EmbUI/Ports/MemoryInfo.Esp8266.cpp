@@ -18,3 +18,9 @@ size_t getLargestAvailableBlock() {
   umm_info(0, 0);
   return ummHeapInfo.maxFreeContiguousBlocks * block_size;
 }
+
+void getMemoryInfo(size_t &total, size_t &largest) {
+  umm_info(0, 0);
+  total = ummHeapInfo.freeBlocks * block_size;
+  largest = ummHeapInfo.maxFreeContiguousBlocks * block_size;
+}
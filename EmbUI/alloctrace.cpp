@@ -0,0 +1,247 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "alloctrace.h"
+
+#ifdef EMBUI_ALLOCTRACE
+#include <Arduino.h>
+
+#define AT_MAGIC        0xA11C7ACEUL
+#define AT_MAXSIZE      0xFFFFFFUL      // больше в заголовок не помещается, такие блоки не отслеживаются
+
+AllocTrace alloctrace;
+
+typedef struct at_hdr_t {
+    uint32_t size : 24;
+    uint32_t site : 8;
+    uint32_t check;             // AT_MAGIC ^ адрес блока, отличает свои блоки от чужих
+} at_hdr_t;
+
+#ifdef EMBUI_ALLOCTRACE_MALLOC
+extern "C" {
+    void *__real_malloc(size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    void __real_free(void *ptr);
+}
+ #define AT_MALLOC   __real_malloc
+ #define AT_REALLOC  __real_realloc
+ #define AT_FREE     __real_free
+#else
+ #define AT_MALLOC   ::malloc
+ #define AT_REALLOC  ::realloc
+ #define AT_FREE     ::free
+#endif
+
+// на ESP8266 выделения из событий SDK не вытесняют loop(), блокировка нужна только для двухъядерного ESP32
+#ifdef ESP32
+static portMUX_TYPE at_mux = portMUX_INITIALIZER_UNLOCKED;
+ #define AT_LOCK()   portENTER_CRITICAL(&at_mux)
+ #define AT_UNLOCK() portEXIT_CRITICAL(&at_mux)
+#else
+ #define AT_LOCK()
+ #define AT_UNLOCK()
+#endif
+
+static inline uint32_t at_check(const void *ptr){ return AT_MAGIC ^ (uint32_t)(uintptr_t)ptr; }
+
+/**
+ * место в таблице по адресу вызова, открытая адресация; таблица заполнена - общая запись 0
+ */
+uint8_t AllocTrace::index(uintptr_t addr){
+    const uint8_t n = EMBUI_ALLOCTRACE_SITES - 1;
+    uint8_t i = (uint32_t)(addr >> 2) * 2654435761UL % n;
+    for (uint8_t k = 0; k < n; k++) {
+        at_site_t &s = sites[1 + i];
+        if (s.addr == addr) return 1 + i;
+        if (!s.addr) {
+            s.addr = addr;
+            return 1 + i;
+        }
+        if (++i == n) i = 0;
+    }
+    return 0;
+}
+
+void AllocTrace::account(uint8_t idx, uint32_t size){
+    at_site_t &s = sites[idx];
+    ++s.count;
+    s.bytes += size;
+    s.live += size;
+    if (s.live > s.peak) s.peak = s.live;
+    total_live += size;
+    if (total_live > total_peak) total_peak = total_live;
+}
+
+void AllocTrace::release(uint8_t idx, uint32_t size){
+    sites[idx].live -= size;
+    total_live -= size;
+}
+
+void *AllocTrace::alloc(size_t size, uintptr_t site){
+    if (size > AT_MAXSIZE) return AT_MALLOC(size);
+
+    at_hdr_t *h = (at_hdr_t*)AT_MALLOC(size + sizeof(at_hdr_t));
+    AT_LOCK();
+    if (!h) {
+        ++failed;
+        AT_UNLOCK();
+        return nullptr;
+    }
+    uint8_t idx = index(site);
+    account(idx, size);
+    AT_UNLOCK();
+
+    h->size = size;
+    h->site = idx;
+    h->check = at_check(h + 1);
+    return h + 1;
+}
+
+void *AllocTrace::realloc(void *ptr, size_t size, uintptr_t site){
+    if (!ptr) return alloc(size, site);
+    if (!size) {
+        free(ptr);
+        return nullptr;
+    }
+
+    at_hdr_t *h = (at_hdr_t*)ptr - 1;
+    if (h->check != at_check(ptr)) return AT_REALLOC(ptr, size);    // чужой блок так и остается неотслеживаемым
+    if (size > AT_MAXSIZE) return nullptr;
+
+    uint32_t oldsize = h->size;
+    uint8_t oldsite = h->site;
+    at_hdr_t *nh = (at_hdr_t*)AT_REALLOC(h, size + sizeof(at_hdr_t));
+    AT_LOCK();
+    if (!nh) {
+        ++failed;           // старый блок остается как был
+        AT_UNLOCK();
+        return nullptr;
+    }
+    release(oldsite, oldsize);
+    uint8_t idx = index(site);
+    account(idx, size);
+    AT_UNLOCK();
+
+    nh->size = size;
+    nh->site = idx;
+    nh->check = at_check(nh + 1);
+    return nh + 1;
+}
+
+void AllocTrace::free(void *ptr){
+    if (!ptr) return;
+    at_hdr_t *h = (at_hdr_t*)ptr - 1;
+    if (h->check != at_check(ptr)) {
+        AT_LOCK();
+        ++untracked;
+        AT_UNLOCK();
+        AT_FREE(ptr);
+        return;
+    }
+    AT_LOCK();
+    release(h->site, h->size);
+    AT_UNLOCK();
+    h->check = 0;           // повторный free() уйдет в аллокатор как чужой блок, а не исказит счетчики
+    AT_FREE(h);
+}
+
+void AllocTrace::reset(){
+    AT_LOCK();
+    for (uint8_t i = 0; i < EMBUI_ALLOCTRACE_SITES; i++) {
+        at_site_t &s = sites[i];
+        s.count = s.bytes = 0;
+        s.peak = s.live;
+    }
+    total_peak = total_live;
+    untracked = failed = 0;
+    AT_UNLOCK();
+}
+
+void AllocTrace::printTo(Print &out, uint8_t top, uint8_t by) const {
+    out.printf_P(PSTR("alloc live/peak: %lu/%lu bytes, untracked free: %lu, failed: %lu\n"),
+        (unsigned long)total_live, (unsigned long)total_peak, (unsigned long)untracked, (unsigned long)failed);
+    out.print(F("site            count        bytes         live         peak\n"));
+
+    uint8_t done[(EMBUI_ALLOCTRACE_SITES + 7) / 8] = {};
+    for (uint8_t r = 0; r < top; r++) {
+        int16_t best = -1;
+        uint32_t bestv = 0;
+        for (uint8_t i = 0; i < EMBUI_ALLOCTRACE_SITES; i++) {
+            const at_site_t &s = sites[i];
+            if (done[i >> 3] & (1 << (i & 7)) || (!s.count && !s.live)) continue;
+            uint32_t v = by == AT_BY_PEAK ? s.peak : by == AT_BY_BYTES ? s.bytes : by == AT_BY_COUNT ? s.count : s.live;
+            if (best < 0 || v > bestv) {
+                best = i;
+                bestv = v;
+            }
+        }
+        if (best < 0) break;
+        done[best >> 3] |= 1 << (best & 7);
+
+        const at_site_t &s = sites[best];
+        if (best) out.printf_P(PSTR("0x%08lx"), (unsigned long)s.addr);
+        else out.print(F("other     "));
+        out.printf_P(PSTR(" %10lu %12lu %12lu %12lu\n"), (unsigned long)s.count, (unsigned long)s.bytes,
+            (unsigned long)s.live, (unsigned long)s.peak);
+    }
+}
+
+/**
+ * адрес возврата из перехватчика - место вызова new/malloc
+ */
+static inline uintptr_t at_caller(uintptr_t a){
+#ifdef ESP32
+    return (a & 0x3fffffffUL) | 0x40000000UL;   // в старших битах ABI окон регистров хранит размер окна
+#else
+    return a;
+#endif
+}
+#define AT_CALLER() at_caller((uintptr_t)__builtin_return_address(0))
+
+// имена operator new/delete после манглинга зависят от size_t
+#if __SIZEOF_SIZE_T__ == 4
+ #define AT_NEW          __wrap__Znwj
+ #define AT_NEWA         __wrap__Znaj
+ #define AT_NEW_NT       __wrap__ZnwjRKSt9nothrow_t
+ #define AT_NEWA_NT      __wrap__ZnajRKSt9nothrow_t
+ #define AT_DEL_SIZED    __wrap__ZdlPvj
+ #define AT_DELA_SIZED   __wrap__ZdaPvj
+#else
+ #define AT_NEW          __wrap__Znwm
+ #define AT_NEWA         __wrap__Znam
+ #define AT_NEW_NT       __wrap__ZnwmRKSt9nothrow_t
+ #define AT_NEWA_NT      __wrap__ZnamRKSt9nothrow_t
+ #define AT_DEL_SIZED    __wrap__ZdlPvm
+ #define AT_DELA_SIZED   __wrap__ZdaPvm
+#endif
+
+extern "C" {
+
+// std::nothrow_t передается по ссылке, то есть указателем
+void *AT_NEW(size_t size){ return alloctrace.alloc(size, AT_CALLER()); }
+void *AT_NEWA(size_t size){ return alloctrace.alloc(size, AT_CALLER()); }
+void *AT_NEW_NT(size_t size, const void *){ return alloctrace.alloc(size, AT_CALLER()); }
+void *AT_NEWA_NT(size_t size, const void *){ return alloctrace.alloc(size, AT_CALLER()); }
+void __wrap__ZdlPv(void *ptr){ alloctrace.free(ptr); }
+void __wrap__ZdaPv(void *ptr){ alloctrace.free(ptr); }
+void AT_DEL_SIZED(void *ptr, size_t){ alloctrace.free(ptr); }
+void AT_DELA_SIZED(void *ptr, size_t){ alloctrace.free(ptr); }
+
+#ifdef EMBUI_ALLOCTRACE_MALLOC
+void *__wrap_malloc(size_t size){ return alloctrace.alloc(size, AT_CALLER()); }
+
+void *__wrap_calloc(size_t n, size_t size){
+    if (size && n > SIZE_MAX / size) return nullptr;
+    void *ptr = alloctrace.alloc(n * size, AT_CALLER());
+    if (ptr) memset(ptr, 0, n * size);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size){ return alloctrace.realloc(ptr, size, AT_CALLER()); }
+void __wrap_free(void *ptr){ alloctrace.free(ptr); }
+#endif
+
+}
+#endif
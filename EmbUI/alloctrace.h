@@ -0,0 +1,87 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+/**
+ * Трассировка выделений памяти по местам вызова, включается -DEMBUI_ALLOCTRACE
+ *
+ * Перехватываются operator new/delete (включая [] и nothrow), с -DEMBUI_ALLOCTRACE_MALLOC еще malloc/calloc/realloc/free.
+ * Перехват делает линкер, флаги для 32-битного size_t (ESP8266, ESP32):
+ *   -Wl,--wrap=_Znwj,--wrap=_Znaj,--wrap=_ZnwjRKSt9nothrow_t,--wrap=_ZnajRKSt9nothrow_t
+ *   -Wl,--wrap=_ZdlPv,--wrap=_ZdaPv,--wrap=_ZdlPvj,--wrap=_ZdaPvj
+ * и для EMBUI_ALLOCTRACE_MALLOC:
+ *   -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+ * на хосте с 64-битным size_t вместо j в именах new - m (_Znwm, _ZdlPvm ...)
+ *
+ * Место вызова - адрес возврата из new/malloc, /alloc выводит его в hex,
+ * имя функции дает xtensa-lx106-elf-addr2line -fe firmware.elf 0x4020xxxx.
+ * String и JsonDocument выделяют память внутри себя, их временные объекты попадают на место внутри String/ArduinoJson.
+ *
+ * Перед блоком хранится заголовок 8 байт с размером, номером места и контрольным словом,
+ * free() блока без заголовка (выделен до перехвата или в обход него, например pvPortMalloc) отдается аллокатору как есть.
+ * Обратное недопустимо: блок из перехваченного malloc() нельзя освобождать мимо free(),
+ * на ESP32 часть кода IDF освобождает память через heap_caps_free(), там безопасно перехватывать только new/delete
+ */
+#ifdef EMBUI_ALLOCTRACE
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef EMBUI_ALLOCTRACE_SITES
+#define EMBUI_ALLOCTRACE_SITES  64      // сколько мест вызова отслеживается, не больше 255, нулевое - "остальные"
+#endif
+
+class Print;
+
+class AllocTrace {
+  public:
+    typedef struct at_site_t {
+        uintptr_t addr;         // адрес возврата, 0 - запись свободна
+        uint32_t count;         // выделений
+        uint32_t bytes;         // байт выделено всего
+        uint32_t live;          // байт занято сейчас
+        uint32_t peak;          // максимум live
+    } at_site_t;
+
+    typedef enum : uint8_t {
+        AT_BY_LIVE = 0,
+        AT_BY_PEAK,
+        AT_BY_BYTES,
+        AT_BY_COUNT
+    } at_sort_t;
+
+    void *alloc(size_t size, uintptr_t site);
+    void *realloc(void *ptr, size_t size, uintptr_t site);
+    void free(void *ptr);
+
+    const at_site_t &site(uint8_t i) const { return sites[i]; }
+    uint32_t live() const { return total_live; }
+    uint32_t peak() const { return total_peak; }
+
+    /**
+     * первые top мест по выбранному полю, таблица сортируется выбором прямо при выводе:
+     * вывод в поток сам выделяет память и не должен требовать копии таблицы
+     */
+    void printTo(Print &out, uint8_t top = 20, uint8_t by = AT_BY_LIVE) const;
+    // обнулить счетчики, занятая память (live) остается: блоки еще будут освобождаться
+    void reset();
+
+  private:
+    at_site_t sites[EMBUI_ALLOCTRACE_SITES];
+    uint32_t total_live;
+    uint32_t total_peak;
+    uint32_t untracked;         // free() блоков без заголовка
+    uint32_t failed;            // аллокатор вернул nullptr
+
+    uint8_t index(uintptr_t addr);
+    void account(uint8_t idx, uint32_t size);
+    void release(uint8_t idx, uint32_t size);
+};
+
+// объект без конструктора: таблица в .bss и готова до вызова любых статических конструкторов
+extern AllocTrace alloctrace;
+
+#endif
@@ -0,0 +1,37 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "gpio.h"
+
+btn_event_t Button::poll(bool level, uint32_t now){
+    if (level != raw) {
+        raw = level;
+        changed = now;
+    }
+
+    if (raw != down && now - changed >= EMBUI_BTN_DEBOUNCE) {
+        down = raw;
+        if (down) {
+            pressed = changed;
+            stage = 0;
+            return BTN_PRESS;
+        }
+        uint8_t s = stage;
+        stage = 0;
+        return s == 0 ? BTN_SHORT : s == 1 ? BTN_LONG_RELEASE : BTN_NONE;
+    }
+
+    if (!down) return BTN_NONE;
+    uint32_t held = now - pressed;
+    if (stage == 0 && held >= EMBUI_BTN_LONG) {
+        stage = 1;
+        return BTN_LONG;
+    }
+    if (stage == 1 && held >= EMBUI_BTN_VERYLONG) {
+        stage = 2;
+        return BTN_VERYLONG;
+    }
+    return BTN_NONE;
+}
@@ -5,40 +5,318 @@
 
 #include "EmbUI.h"
 
-void EmbUI::save(const char *_cfg, bool force){
-    if ((sysData.isNeedSave || force) && LittleFS.begin()) {
-        File configFile;
-        if (_cfg == nullptr) {
-            LOG(println, F("UI: Save default main config file"));
-            configFile = LittleFS.open(FPSTR(P_cfgfile), "w"); // PSTR("w") использовать нельзя, будет исключение!
-        } else {
-            LOG(printf_P, PSTR("UI: Save %s main config file\n"), _cfg);
-            configFile = LittleFS.open(_cfg, "w"); // PSTR("w") использовать нельзя, будет исключение!
-        }
+/**
+ * загрузчик пространств имен для ConfigStore
+ */
+static void cfg_loadshard(ConfigStore &store, uint8_t shard){
+    char path[CFG_NS_LEN + 16];
+    snprintf_P(path, sizeof(path), P_cfgshard, store.shard(shard)->name);
+    File f = LittleFS.open(path, "r");
+    if (!f) return;
+
+    unsigned long t = micros();
+    size_t docsize = f.size() * 2;
+    DynamicJsonDocument doc(docsize > JSON_OBJECT_SIZE(8) ? docsize : JSON_OBJECT_SIZE(8));
+    DeserializationError error = deserializeJson(doc, f);
+    f.close();
+    if (error) {
+        LOG(printf_P, PSTR("UI: %s deserializeJson error: %s\n"), path, error.c_str());
+        return;
+    }
+    store.fromJson(doc.as<JsonObjectConst>());
+    LOG(printf_P, PSTR("UI: config %s loaded in %lu us\n"), path, micros() - t);
+}
+
+/**
+ * сохранение конфига
+ * данные снимаются сразу, а на флеш попадают в фоне из handle(), по окончании вызывается cb(успех)
+ * без имени файла изменения дописываются в журнал, пока он не переполнен, иначе (или при force)
+ * пишется полный снимок через временный файл и переименование
+ * если еще идет предыдущая запись, сохранение ставится в очередь и начнется после нее
+ */
+void EmbUI::save(const char *_cfg, bool force, cfgSaveCallback cb){
+    HEAP_TAG(HEAP_SAVE);
+    if (!(sysData.isNeedSave || force)) {
+        if (cb) cb(true);
+        return;
+    }
 
-        String cfg_str;
-        serializeJson(cfg, cfg_str);
-        configFile.print(cfg_str);
-        configFile.flush();
-        configFile.close();
+    // до любого обращения к ФС: идущая запись держит открытый файл
+    if (cfgw.busy()) {
+        // предыдущая запись еще идет: запрос ждет ее окончания и выполняется из cfg_persist()
+        save_queue(_cfg, force, cb);
+        return;
+    }
+    if (!fs_begin()) {
+        if (cb) cb(false);
+        return;
+    }
+    save_cb = cb;
+    sysData.cfg_shards = true;      // пространства имен пишутся следом, из cfg_persist()
 
-        //cfg.garbageCollect(); // несколько раз ловил Exception (3) предположительно тут, возвращаю пока проверенный способ
-        deserializeJson(cfg, cfg_str);
+    if (_cfg != nullptr) {
+        // копия в отдельный файл, основной конфиг и журнал не меняются
+        LOG(printf_P, PSTR("UI: Save %s main config file\n"), _cfg);
+        save_mode = CFG_SAVE_COPY;
+        if (cfgw.begin(_cfg, FPSTR(P_cfgtmp))) cfgw.stream(cfg, ConfigStore::cursor(CFG_OUT_JSON));
+        else save_done(false);
+        return;
+    }
+
+    if (!force && !sysData.cfg_compact && LittleFS.exists(FPSTR(P_cfgfile)) && cfgw.begin(FPSTR(P_cfgjournal), nullptr)) {
+        if (cfgw.filesize() < EMBUI_CFG_JOURNAL) {
+            LOG(println, F("UI: journal config changes"));
+            save_mode = CFG_SAVE_JOURNAL;
+            cfgw.stream(cfg, ConfigStore::cursor(CFG_OUT_JOURNAL, 0));
+            sysData.isNeedSave = false;
+            return;
+        }
+        cfgw.abort();
+    }
+
+    // журнал сворачивается в новый снимок и убирается с дороги перед его переименованием
+    LOG(println, F("UI: Save default main config file"));
+    save_mode = CFG_SAVE_SNAPSHOT;
+    if (cfgw.begin(FPSTR(P_cfgfile), FPSTR(P_cfgtmp))) {
+        cfgw.retire(FPSTR(P_cfgjournal), FPSTR(P_cfgjnlold));
+        // двоичная копия - из тех же значений, что уходят в снимок, а не из конфига, каким он станет к концу записи
+        cfgw.mirror(FPSTR(P_cfgbin), FPSTR(P_cfgbintmp));
+        // слот, измененный до того, как до него дошла запись, попадет в снимок с новым значением и снова в журнал
+        cfgw.stream(cfg, ConfigStore::cursor(CFG_OUT_JSON, 0));
+        cfg.clean();
         sysData.isNeedSave = false;
+    } else {
+        save_done(false);
+    }
+}
+
+/**
+ * отложить сохранение до окончания текущей записи
+ * запросы основного конфига сливаются в один, более новая копия в файл замещает ожидающую;
+ * колбэк один, его получает следующая запись из очереди, колбэк замещенного запроса вызывается с false
+ */
+void EmbUI::save_queue(const char *_cfg, bool force, cfgSaveCallback cb){
+    if (_cfg) {
+        save_qpath = _cfg;
+    } else {
+        sysData.cfg_qmain = true;
+        if (force) sysData.cfg_compact = true;      // снимок вместо журнала
+    }
+    if (cb) {
+        if (save_qcb) save_qcb(false);
+        save_qcb = cb;
+    }
+    sysData.cfg_queued = true;
+}
+
+/**
+ * выполнить отложенное сохранение, сначала копию, затем основной конфиг
+ */
+void EmbUI::save_next(){
+    cfgSaveCallback cb = save_qcb;
+    save_qcb = nullptr;
+    if (save_qpath.length()) {
+        String path = save_qpath;
+        save_qpath = String();
+        sysData.cfg_queued = sysData.cfg_qmain;
+        save(path.c_str(), true, cb);
+        return;
+    }
+    sysData.cfg_queued = sysData.cfg_qmain = false;
+    save(nullptr, sysData.cfg_compact, cb);     // изменений после записанного журнала может и не быть
+}
+
+/**
+ * фоновая запись конфига, вызывается на каждом проходе handle()
+ */
+void EmbUI::cfg_persist(){
+    if (!cfgw.busy() && !sysData.cfg_queued && !sysData.cfg_shards) return;
+    HEAP_TAG(HEAP_SAVE);
+    if (!cfgw.busy()) {
+        if (sysData.cfg_queued) save_next();
+        else cfg_writeshard();
+        return;
+    }
+    int8_t r = cfgw.step();
+    if (r > 0) return;
+    save_done(r == 0);
+}
+
+void EmbUI::save_done(bool ok){
+    METRIC_INC(ok ? M_CFG_SAVES : M_CFG_SAVE_ERRORS);
+    if (save_mode == CFG_SAVE_SNAPSHOT && ok) {
+        LittleFS.remove(FPSTR(P_cfgjnlold));
+        sysData.cfg_compact = false;
+    }
+    if (save_mode == CFG_SAVE_SHARD) {
+        if (!ok) cfg.touch(save_shard);     // повторим при следующем сохранении
+        LOG(printf_P, PSTR("UI: config shard %s saved %s\n"), cfg.shard(save_shard)->name, ok ? "ok" : "with error");
+        return;
+    }
+    if (save_mode != CFG_SAVE_COPY && !ok) {
+        // недописанный журнал или снимок, при следующем сохранении пишем снимок целиком
+        sysData.cfg_compact = true;
+        sysData.isNeedSave = true;
+        autosave_arm();
+    }
+    LOG(printf_P, PSTR("UI: config saved %s\n"), ok ? "ok" : "with error");
+
+    if (save_cb) {
+        cfgSaveCallback cb = save_cb;
+        save_cb = nullptr;
+        cb(ok);
     }
-    delay(DELAY_AFTER_FS_WRITING); // задержка после записи
+}
+
+/**
+ * завести автосохранение через asave секунд, уже заведенное не сдвигается, если не reset
+ */
+void EmbUI::autosave_arm(bool reset){
+    if (tasave.active() && !reset) return;
+    tasave.once(sysData.asave * 1000UL, [this](){ PROF_CALL(PROF_AUTOSAVE, autosave()); });
 }
 
 void EmbUI::autosave(){
-    if (sysData.isNeedSave && millis() > astimer + sysData.asave*1000){
-        save();
-        LOG(println, F("UI: AutoSave"));
-        astimer = millis();
+    if (!sysData.isNeedSave) return;
+    LOG(println, F("UI: AutoSave"));
+    save();     // при идущей записи сохранение встанет в очередь
+}
+
+/**
+ * загрузить двоичную копию /config.json, если она записана вместе с текущей версией файла:
+ * размер и crc32 файла должны совпасть с завершающим блоком копии, так что правка /config.json в обход save() ее отменяет
+ */
+bool EmbUI::cfg_loadbin(){
+    if (!LittleFS.exists(FPSTR(P_cfgbin)) || !LittleFS.exists(FPSTR(P_cfgfile))) return false;
+
+    File bin = LittleFS.open(FPSTR(P_cfgbin), "r");
+    size_t len = bin.size();
+    ConfigStore::cfg_bintail_t hdr;
+    if (len < sizeof(hdr) || !bin.seek(len - sizeof(hdr)) || bin.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr)) {
+        bin.close();
+        return false;
+    }
+
+    File json = LittleFS.open(FPSTR(P_cfgfile), "r");
+    bool fresh = json.size() == hdr.jsonsize;
+    if (fresh) {
+        uint8_t chunk[EMBUI_CFG_CHUNK];
+        uint32_t crc = 0;
+        size_t n;
+        while ((n = json.read(chunk, sizeof(chunk))) > 0) crc = cfg_crc32(crc, chunk, n);
+        fresh = crc == hdr.jsoncrc;
+    }
+    json.close();
+    if (!fresh) {
+        bin.close();
+        LOG(println, F("UI: config.bin is stale"));
+        return false;
+    }
+
+    // весь файл одним чтением
+    uint8_t *buf = (uint8_t*)malloc(len);
+    bool ok = buf && bin.seek(0);
+    if (ok) ok = bin.read(buf, len) == len && cfg.fromBin(buf, len);
+    free(buf);
+    bin.close();
+    return ok;
+}
+
+/**
+ * записать очередное измененное пространство имен целиком, по одному файлу за раз
+ */
+void EmbUI::cfg_writeshard(){
+    uint8_t sh = cfg.dirtyshard();
+    if (!sh) {
+        sysData.cfg_shards = false;
+        return;
+    }
+    // в файл должны попасть и ключи, которые еще не читались
+    cfg.load(sh);
+
+    char path[CFG_NS_LEN + 16];
+    snprintf_P(path, sizeof(path), P_cfgshard, cfg.shard(sh)->name);
+    save_mode = CFG_SAVE_SHARD;
+    save_shard = sh;
+    if (cfgw.begin(path, FPSTR(P_cfgtmp))) cfgw.stream(cfg, ConfigStore::cursor(CFG_OUT_JSON, sh));
+    cfg.clean(sh);
+    if (!cfgw.busy()) save_done(false);
+}
+
+/**
+ * при нехватке памяти выгрузить давно не использованное пространство имен
+ * номера слотов при этом меняются, поэтому не во время записи и не с ожидающими наблюдателями
+ */
+void EmbUI::cfg_evict(){
+    if (ESP.getFreeHeap() >= EMBUI_CFG_LOWMEM || cfgw.busy() || cfgobs.pending()) return;
+    uint8_t sh = cfg.lru();
+    if (!sh) return;
+    size_t mem = cfg.memory();
+    cfg.evict(sh);
+    LOG(printf_P, PSTR("UI: low memory, config shard %s evicted, %u -> %u bytes\n"), cfg.shard(sh)->name, mem, cfg.memory());
+}
+
+/**
+ * сброс к заводским настройкам: конфиг со всеми производными файлами
+ */
+void EmbUI::cfg_erase(){
+    cfgw.abort();
+    sysData.cfg_queued = sysData.cfg_qmain = false;
+    save_qpath = String();
+    if (save_qcb) {
+        cfgSaveCallback cb = save_qcb;
+        save_qcb = nullptr;
+        cb(false);
     }
+    LittleFS.remove(FPSTR(P_cfgfile));
+    LittleFS.remove(FPSTR(P_cfgjournal));
+    LittleFS.remove(FPSTR(P_cfgjnlold));
+    LittleFS.remove(FPSTR(P_cfgbin));
+    LittleFS.remove(FPSTR(P_cfgbintmp));
+    LittleFS.remove(FPSTR(P_cfgtmp));
+
+    char path[CFG_NS_LEN + 16];
+    for (uint8_t i = 1; cfg.shard(i); i++) {
+        snprintf_P(path, sizeof(path), P_cfgshard, cfg.shard(i)->name);
+        LittleFS.remove(path);
+    }
+}
+
+/**
+ * снимок, прерванный между переименованием журнала и переименованием /config.tmp:
+ * журнал уже свернут в готовый временный файл, переименование завершается; без временного файла снимок уже на месте.
+ * В этом окне других записей нет, так что /config.tmp - именно этот снимок
+ */
+static void cfg_recover(){
+    if (!LittleFS.exists(FPSTR(P_cfgjnlold))) return;
+    if (LittleFS.exists(FPSTR(P_cfgtmp))) {
+        LittleFS.remove(FPSTR(P_cfgbin));
+        LittleFS.rename(FPSTR(P_cfgtmp), FPSTR(P_cfgfile));
+        LOG(println, F("UI BOOT: interrupted config snapshot completed"));
+    }
+    LittleFS.remove(FPSTR(P_cfgjnlold));
+}
+
+/**
+ * смонтировать LittleFS один раз: на ESP8266 повторный begin() перемонтирует ФС,
+ * и открытый файл фоновой записи становится недействительным
+ */
+bool EmbUI::fs_begin(){
+    if (!sysData.fs_mounted) sysData.fs_mounted = LittleFS.begin();
+    return sysData.fs_mounted;
 }
 
 void EmbUI::load(const char *_cfg){
-    if (LittleFS.begin()) {
+    unsigned long t = micros();
+    cfg.onShardLoad(cfg_loadshard);
+    if (_cfg == nullptr && fs_begin()) cfg_recover();
+    if (_cfg == nullptr && fs_begin() && cfg_loadbin()) {
+        LOG(printf_P, PSTR("UI BOOT: config.bin %u keys in %lu us\n"), cfg.size(), micros() - t);
+        load_journal();
+        return;
+    }
+
+    if (fs_begin()) {
         File configFile;
         if (_cfg == nullptr) {
             LOG(println, F("Load default main config file"));
@@ -48,20 +326,52 @@ void EmbUI::load(const char *_cfg){
             configFile = LittleFS.open(_cfg, "r"); // PSTR("w") использовать нельзя, будет исключение!
         }
 
-        String cfg_str = configFile.readString();
-        configFile.close();
-        if (cfg_str == F("")){
+        if (!configFile || !configFile.size()){
             LOG(println, F("Failed to open config file"));
             //save(); // this does nothing on a first run
-            return;
-        }
-        DeserializationError error = deserializeJson(cfg, cfg_str);
-        if (error) {
-            LOG(print, F("JSON config deserializeJson error: "));
-            LOG(println, error.code());
-            return;
+        } else {
+            // разбор прямо из файла, строки копируются в документ один раз;
+            // документ временный, поэтому его размер следует за размером файла
+            size_t docsize = configFile.size() * 2;
+            DynamicJsonDocument doc(docsize > __CFGSIZE ? docsize : __CFGSIZE);
+            DeserializationError error = deserializeJson(doc, configFile);
+            configFile.close();
+            if (error) {
+                LOG(print, F("JSON config deserializeJson error: "));
+                LOG(println, error.code());
+            } else {
+                cfg.fromJson(doc.as<JsonObjectConst>());
+                LOG(printf_P, PSTR("UI BOOT: config.json %u keys in %lu us\n"), cfg.size(), micros() - t);
+                // двоичная копия отсутствует или устарела, а пишется она только вместе со снимком
+                if (_cfg == nullptr) {
+                    sysData.cfg_compact = true;
+                    sysData.isNeedSave = true;
+                    autosave_arm();
+                }
+            }
         }
+
+        if (_cfg == nullptr) load_journal();
     } else {
             LOG(println, F("Can't initialize LittleFS"));
     }
 }
+
+/**
+ * изменения, накопленные в журнале после последнего снимка
+ */
+void EmbUI::load_journal(){
+    if (!LittleFS.exists(FPSTR(P_cfgjournal))) return;
+
+    unsigned long t = micros();
+    File jnl = LittleFS.open(FPSTR(P_cfgjournal), "r");
+    size_t n = cfg.replay(jnl);
+    LOG(printf_P, PSTR("UI BOOT: config journal %u bytes, %u records in %lu us\n"), jnl.size(), n, micros() - t);
+    if (jnl.available()) {
+        // битый хвост: дописывать после него нельзя, при следующем сохранении журнал сворачивается
+        sysData.cfg_compact = true;
+        sysData.isNeedSave = true;
+        autosave_arm();
+    }
+    jnl.close();
+}
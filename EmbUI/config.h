@@ -12,4 +12,490 @@
 #include "LittleFS.h"
 #endif
 
-#endif
\ No newline at end of file
+#include "globals.h"
+#include <ArduinoJson.h>
+
+#ifndef EMBUI_CFG_GROW
+#define EMBUI_CFG_GROW      8       // на сколько слотов расширяется таблица ключей
+#endif
+
+#ifndef EMBUI_CFG_PAGE
+#define EMBUI_CFG_PAGE      256     // страница арены строк конфига, байт
+#endif
+
+#ifndef EMBUI_CFG_SPARSE
+#define EMBUI_CFG_SPARSE    2       // со скольких замусоренных страниц арены запись значения начинает их освобождать
+#endif
+
+#ifndef EMBUI_CFG_SHARDS
+#define EMBUI_CFG_SHARDS    8       // сколько пространств имен "ns/key" хранится в отдельных файлах /cfg_ns.json
+#endif
+
+#ifndef EMBUI_CFG_LOWMEM
+#define EMBUI_CFG_LOWMEM    8192    // свободной памяти меньше - пространства имен выгружаются из ОЗУ
+#endif
+
+#define CFG_NS_LEN          12      // максимальная длина имени пространства, с '\0'
+#define CFG_KEY_LEN         255     // максимальная длина ключа: в журнале и /config.bin под нее один байт
+#define CFG_SHARD_ALL       0xFF    // printTo(): все загруженные ключи
+
+#ifndef EMBUI_CFG_JOURNAL
+#define EMBUI_CFG_JOURNAL   4096    // размер журнала изменений, после которого он сворачивается в /config.json
+#endif
+
+#ifndef EMBUI_CFG_CHUNK
+#define EMBUI_CFG_CHUNK     256     // буфер записи конфига: столько байт уходит на флеш за один проход handle()
+#endif
+
+#ifndef EMBUI_CFG_OBSERVERS
+#define EMBUI_CFG_OBSERVERS 16      // сколько наблюдателей можно зарегистрировать через EmbUI::observe()
+#endif
+
+#ifndef EMBUI_CFG_CHANGES
+#define EMBUI_CFG_CHANGES   8       // сколько изменений копится в таблице до рассылки наблюдателям, дальше - в куче
+#endif
+
+#define CFG_JOURNAL_MAGIC   0x4A    // 'J', начало записи журнала
+#define CFG_BIN_MAGIC       0x42435545UL    // "EUCB", заголовок /config.bin
+#define CFG_BIN_VERSION     2
+#define CFG_LOOP_HIST       8       // интервалы гистограммы: <1,<2,<4 ... <64, >=64 мс
+
+// тип значения параметра конфигурации
+typedef enum : uint8_t {
+    CFG_STR = 0,        // строка, как было раньше
+    CFG_INT,
+    CFG_FLOAT
+} cfg_type_t;
+
+// формат потоковой печати ConfigStore::print()
+typedef enum : uint8_t {
+    CFG_OUT_JSON = 0,   // {"key":"value",...}
+    CFG_OUT_JOURNAL     // записи журнала для измененных слотов
+} cfg_out_t;
+
+// crc32 (полином 0xEDB88320) журнала, /config.bin и проверки /config.json; crc - результат для предыдущих данных, начало - 0
+uint32_t cfg_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * Ключ конфигурации: строка в RAM или указатель на PROGMEM (FPSTR(P_xxx))
+ * ключи из PROGMEM не копируются, а сравниваются сначала по указателю
+ */
+struct cfgkey_t {
+    const char *p;
+    bool pgm;
+
+    cfgkey_t(const char *key) : p(key), pgm(false) {}
+    cfgkey_t(const String &key) : p(key.c_str()), pgm(false) {}
+    cfgkey_t(const __FlashStringHelper *key) : p((const char*)key), pgm(true) {}
+
+    uint32_t hash() const { return pgm ? embui_hash_P(p) : embui_hash(p); }
+};
+
+/**
+ * Арена строк конфига: страницы по EMBUI_CFG_PAGE байт, выделяемые по мере надобности
+ * строка занимает место в текущей странице (сдвиг указателя), освобожденное место учитывается как мусор,
+ * страница без живых строк возвращается в кучу. Перед каждой строкой 2 байта ее емкости
+ */
+class CfgArena {
+    typedef struct cfg_page_t {
+        struct cfg_page_t *next;
+        uint16_t size;          // размер data
+        uint16_t used;          // занято с начала страницы
+        uint16_t live;          // из них в живых строках
+        char data[];
+    } cfg_page_t;
+
+    cfg_page_t *pages = nullptr;    // первая - текущая, в нее идут новые строки
+    uint16_t npages = 0;
+    uint16_t nsparse = 0;           // не текущих страниц, где мусора больше половины
+
+    cfg_page_t *page(const char *p) const;
+    // в не текущую страницу строки не добавляются, так что замусоренной она остается до освобождения
+    static bool thin(const cfg_page_t *pg){ return (size_t)(pg->used - pg->live) * 2 > pg->used; }
+
+  public:
+    ~CfgArena(){ clear(); }
+
+    // место под строку длиной len (+ завершающий '\0')
+    char *alloc(size_t len);
+    void release(const char *p);
+    // сколько символов (с '\0') помещается по адресу p без перевыделения
+    size_t capacity(const char *p) const;
+
+    /**
+     * страница, которую выгодно освободить переносом ее живых строк: мусора больше половины
+     * @return сколько в ней живых байт (0 - такой нет), lo/hi - границы страницы
+     */
+    size_t sparse(const char **lo, const char **hi) const;
+    uint16_t sparsepages() const { return nsparse; }
+
+    void clear();
+
+    // статистика
+    size_t pagecount() const { return npages; }
+    size_t bytes() const;       // выделено под страницы
+    size_t live() const;        // в живых строках
+    size_t garbage() const;     // освобождено внутри страниц
+};
+
+/**
+ * Хранилище конфигурации
+ * каждый слот держит каноническое строковое значение (в таком виде оно попадает в /config.json)
+ * и разобранное значение для слотов, созданных с типом int/float, так что param<int>() не разбирает строку
+ */
+class ConfigStore {
+  public:
+    typedef struct cfg_slot_t {
+        const char *key;        // ключ: указатель во flash или копия в куче
+        char *str;              // строковое значение
+        uint32_t hash;          // embui_hash(key)
+        union {
+            int32_t i;
+            float f;
+        } v;                    // разобранное значение для CFG_INT/CFG_FLOAT
+        uint8_t type;           // cfg_type_t
+        uint8_t shard;          // 0 - основной /config.json, иначе номер пространства имен + 1
+        bool pkey:1;            // ключ во flash, не освобождать
+        bool dirty:1;           // значение изменено после последней записи на флеш
+        bool dflt:1;            // значение по умолчанию из create(): его нет в файле, при выгрузке пространства слот остается
+    } cfg_slot_t;
+
+    // пространство имен: ключи "ns/..." живут в своем файле, загружаются при первом обращении
+    typedef struct cfg_shard_t {
+        char name[CFG_NS_LEN];
+        uint32_t lastuse;       // millis() последнего обращения, для вытеснения
+        bool loaded:1;
+        bool dirty:1;
+    } cfg_shard_t;
+
+    typedef void (*cfgShardLoader)(ConfigStore &store, uint8_t shard);
+
+    /**
+     * двоичный снимок /config.bin: count записей - тип (1 байт), длина ключа (1), длина значения (2), ключ, значение,
+     * за ними завершающий блок; он пишется последним, когда число записей и их crc уже известны.
+     * Снимок пишется тем же проходом, что и /config.json, и годен, только пока crc файла совпадает
+     */
+    typedef struct __attribute__((packed)) cfg_bintail_t {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t reserved;
+        uint16_t count;
+        uint32_t jsonsize;      // размер /config.json, записанного вместе со снимком
+        uint32_t jsoncrc;       // и его crc32
+        uint32_t bodylen;
+        uint32_t crc;           // crc32 записей
+    } cfg_bintail_t;
+
+    /**
+     * позиция потоковой печати print(), между вызовами конфиг может меняться:
+     * новые слоты добавляются в конец и тоже попадают в вывод
+     */
+    typedef struct cfg_cursor_t {
+        uint16_t slot;          // следующий слот
+        uint16_t count;         // напечатано записей
+        uint8_t fmt;            // cfg_out_t
+        uint8_t shard;          // CFG_SHARD_ALL или номер пространства
+        bool done;
+    } cfg_cursor_t;
+
+  private:
+    cfg_slot_t *slots = nullptr;
+    uint16_t cnt = 0;
+    uint16_t cap = 0;
+    cfg_shard_t shards[EMBUI_CFG_SHARDS];
+    uint8_t nshards = 0;
+    cfgShardLoader loader = nullptr;
+
+    // индекс по хэшам ключей, открытая адресация: номер слота + 1, 0 - пусто
+    uint16_t *idx = nullptr;
+    uint16_t idxsize = 0;       // степень двойки, заполнение не больше половины
+
+    void reindex();
+    void idxput(uint16_t i);
+    cfg_slot_t *lookup(const cfgkey_t &key);
+    cfg_slot_t *add(const cfgkey_t &key, uint32_t hash);
+    uint8_t shardof(const cfgkey_t &key, bool reg);
+    static void parse(cfg_slot_t *s);
+    CfgArena strings;           // ключи из RAM и значения
+
+    static void printStr(Print &out, const char *s, bool pgm);
+    bool assign(cfg_slot_t *s, const char *value, size_t len, char **old);
+    void relocate();
+
+  public:
+    ConfigStore(){}
+    ~ConfigStore(){ clear(); }
+
+    // поиск ключа через хэш-индекс, известное пространство имен ключа при необходимости подгружается
+    cfg_slot_t *find(const cfgkey_t &key);
+
+    /**
+     * создать ключ, если его нет. Значение существующего ключа не меняется, но ему назначается тип,
+     * а ключ, прочитанный из файла, заменяется указателем на PROGMEM
+     * @return nullptr, если не хватило памяти или ключ длиннее CFG_KEY_LEN
+     */
+    cfg_slot_t *create(const cfgkey_t &key, const char *value, uint8_t type = CFG_STR);
+
+    /**
+     * записать значение в слот
+     * @param old   если задан, прежнее значение не затирается, а отдается вызывающему (вернуть через release())
+     * @return true, если значение изменилось
+     */
+    bool set(cfg_slot_t *s, const char *value, char **old = nullptr);
+
+    void release(char *old){ strings.release(old); }
+
+    static bool keyeq(const cfg_slot_t *s, const cfgkey_t &key);
+
+    // номер слота можно хранить вместо указателя, который меняется при расширении таблицы,
+    // пока не вытеснено ни одно пространство имен (см. evict())
+    uint16_t index(const cfg_slot_t *s) const { return s - slots; }
+    cfg_slot_t *at(uint16_t i){ return i < cnt ? &slots[i] : nullptr; }
+
+    // ключ слота в RAM (ключи из PROGMEM копируются в buf)
+    static const char *keyname(const cfg_slot_t *s, char *buf, size_t len);
+
+    // значение слота в требуемом типе, без выделения памяти
+    template<typename T> static T as(const cfg_slot_t *s);
+
+    template<typename T> T get(const cfgkey_t &key){ return as<T>(find(key)); }
+
+    /**
+     * экспорт в json: {"key":"value",...}, все значения строками, как в прежнем /config.json
+     */
+    void printTo(Print &out, uint8_t shard = CFG_SHARD_ALL);
+
+    static cfg_cursor_t cursor(uint8_t fmt, uint8_t shard = CFG_SHARD_ALL){
+        cfg_cursor_t c;
+        memset(&c, 0, sizeof(c));
+        c.fmt = fmt;
+        c.shard = shard;
+        return c;
+    }
+
+    /**
+     * потоковая печать: очередная запись (слот) в формате курсора, в конце - завершение формата
+     * CFG_OUT_JOURNAL берет только измененные слоты и сбрасывает у записанных флаг dirty,
+     * запись: magic, длина ключа (1 байт), длина значения (2 байта), ключ, значение, crc32 всего предыдущего
+     * @param bin  CFG_OUT_JSON: туда же записи двоичного снимка с теми же значениями, без завершающего блока
+     * @return false - печатать больше нечего
+     */
+    bool print(Print &out, cfg_cursor_t &c, Print *bin = nullptr);
+
+    /**
+     * импорт из json, значения-не-строки записываются в строковом виде
+     */
+    void fromJson(JsonObjectConst obj);
+
+    /**
+     * применить записи журнала, чтение прекращается на первой битой или недописанной записи
+     * @return число примененных записей
+     */
+    size_t replay(Stream &in);
+
+    bool dirty() const;
+    void clean(uint8_t shard = 0);     // снимок записан, все слоты пространства сохранены
+
+    /**
+     * пространства имен
+     * loader вызывается при первом обращении к ключу "ns/..." и должен загрузить файл пространства через fromJson()
+     */
+    void onShardLoad(cfgShardLoader cb){ loader = cb; }
+    const cfg_shard_t *shard(uint8_t n) const { return n && n <= nshards ? &shards[n - 1] : nullptr; }
+    bool load(uint8_t shard);           // подгрузить, если еще не загружено
+    void touch(uint8_t shard){ if (shard && shard <= nshards) shards[shard - 1].dirty = true; }
+    uint8_t dirtyshard() const;         // первое измененное пространство, 0 - нет таких
+    uint8_t lru() const;                // давно не использованное загруженное пространство без изменений
+    /**
+     * выгрузить ключи пространства из памяти, измененное пространство не выгружается
+     * номера слотов после этого меняются
+     */
+    bool evict(uint8_t shard);
+
+    /**
+     * загрузить двоичный снимок из буфера целиком
+     * @return false если заголовок, версия, crc или размер не сходятся, хранилище при этом не меняется
+     */
+    bool fromBin(const uint8_t *data, size_t len);
+
+    void clear();
+    size_t size() const { return cnt; }
+    size_t memory() const;      // занятая хранилищем память, байт
+    const CfgArena &arena() const { return strings; }
+};
+
+/**
+ * Запись в файл через буфер на EMBUI_CFG_CHUNK байт, заполненный буфер сразу уходит в файл
+ */
+class CfgFile : public Print {
+    char buf[EMBUI_CFG_CHUNK];
+    size_t len = 0;
+
+  public:
+    File file;
+    size_t flushed = 0;     // всего записано в файл
+    uint32_t crc = 0;       // crc32 всего записанного
+    bool err = false;
+
+    bool open(const String &path, const char *mode);
+    void flush();
+    void close();
+    size_t size() const { return flushed + len; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t size) override;
+};
+
+/**
+ * Фоновая запись конфига
+ * слоты печатаются по курсору (ConfigStore::print()) в буфер CfgFile, за вызов step() на флеш попадает одна порция,
+ * так что цикл не ждет флеш, а документ целиком в RAM не собирается
+ */
+class CfgWriter {
+    CfgFile out;
+    CfgFile bin;            // двоичный снимок, который пишется тем же проходом
+    bool active = false;
+    const __FlashStringHelper *tmpfile = nullptr;   // временный файл, nullptr - дописывание в file
+    String target;          // куда переименовать временный файл
+    const __FlashStringHelper *retfrom = nullptr;   // файл, который перестает быть действительным вместе со старым target
+    const __FlashStringHelper *retto = nullptr;
+    const __FlashStringHelper *bintmp = nullptr;    // двоичный снимок: временный файл и куда его переименовать
+    const __FlashStringHelper *bintarget = nullptr;
+
+    uint32_t hist[CFG_LOOP_HIST];   // время итерации loop() во время записи
+    uint32_t loop_max = 0;
+
+    ConfigStore *store = nullptr;   // источник, nullptr - все напечатано
+    ConfigStore::cfg_cursor_t cur;
+
+    void release();
+    bool finishbin();
+
+  public:
+    CfgWriter(){ memset(hist, 0, sizeof(hist)); }
+    ~CfgWriter(){ release(); }
+
+    /**
+     * начать запись
+     * @param path  файл, который дописывается (tmp == nullptr) или создается заново через tmp и переименование
+     */
+    bool begin(const String &path, const __FlashStringHelper *tmp);
+
+    /**
+     * перед переименованием временного файла убрать from под имя to, при неудачном переименовании вернуть обратно
+     * так зависящий от старой версии файл (журнал) не переживает новую, даже если питание пропадет между переименованиями,
+     * удалить to после успешной записи - забота вызывающего
+     */
+    void retire(const __FlashStringHelper *from, const __FlashStringHelper *to){ retfrom = from; retto = to; }
+
+    /**
+     * писать тем же проходом двоичный снимок тех же значений в path через tmp,
+     * он переименовывается только после основного файла, ошибка в нем основную запись не портит
+     */
+    bool mirror(const __FlashStringHelper *path, const __FlashStringHelper *tmp);
+
+    /**
+     * что писать: слоты s по курсору c, печатаются по мере записи, а не в момент сохранения
+     */
+    void stream(ConfigStore &s, const ConfigStore::cfg_cursor_t &c){ if (active) { store = &s; cur = c; } }
+
+    /**
+     * записать очередную порцию
+     * @return 1 - запись продолжается, 0 - успешно завершена, -1 - ошибка
+     */
+    int8_t step();
+
+    void abort();
+    bool busy() const { return active; }
+    size_t filesize(){ return active ? out.file.size() : 0; }
+
+    void loop_time(uint32_t us);
+    const uint32_t *loop_hist() const { return hist; }
+    uint32_t loop_maxtime() const { return loop_max; }
+};
+
+typedef void (*cfgObserver)(const char *key, const char *oldval, const char *newval);
+
+/**
+ * Наблюдатели за изменениями конфига
+ * таблицы фиксированного размера, после регистрации память выделяется, только если за проход меняется больше EMBUI_CFG_CHANGES ключей.
+ * Изменения копятся и рассылаются пачкой из handle(), каждый ключ - один раз, со значением до первого изменения в пачке
+ */
+class CfgObservers {
+    typedef struct observer_t {
+        const char *key;        // ключ или префикс, указатель должен жить все время работы
+        uint32_t hash;          // для точного совпадения
+        cfgObserver cb;
+        uint8_t len;            // длина префикса, 0 - точное совпадение
+        bool pgm;
+    } observer_t;
+
+    typedef struct change_t {
+        uint16_t slot;          // ConfigStore::index()
+        char *old;              // прежнее значение
+    } change_t;
+
+    observer_t obs[EMBUI_CFG_OBSERVERS];
+    change_t changes[EMBUI_CFG_CHANGES];
+    uint8_t nobs = 0;
+    uint8_t nchanges = 0;
+    change_t *spill = nullptr;      // продолжение пачки, когда таблица заполнена
+    uint16_t nspill = 0;
+    uint16_t spillcap = 0;
+
+    bool match(const observer_t &o, const ConfigStore::cfg_slot_t *s, const char *key) const;
+
+  public:
+    /**
+     * подписать cb на изменения ключа key, или всех ключей, начинающихся с key, если prefix
+     */
+    bool add(const cfgkey_t &key, cfgObserver cb, bool prefix);
+
+    // есть ли наблюдатели у ключа
+    bool watched(const ConfigStore::cfg_slot_t *s) const;
+
+    // запомнить изменение, old передается во владение
+    void changed(ConfigStore &store, const ConfigStore::cfg_slot_t *s, char *old);
+
+    // разослать накопленные изменения
+    void dispatch(ConfigStore &store);
+
+    bool pending() const { return nchanges || nspill; }
+};
+
+template<typename T> T ConfigStore::as(const cfg_slot_t *s){
+    if (!s) return 0;
+    switch (s->type) {
+        case CFG_INT: return static_cast<T>(s->v.i);
+        case CFG_FLOAT: return static_cast<T>(s->v.f);
+        default: return static_cast<T>(atol(s->str));
+    }
+}
+
+template<> inline float ConfigStore::as<float>(const cfg_slot_t *s){
+    if (!s) return 0;
+    switch (s->type) {
+        case CFG_INT: return s->v.i;
+        case CFG_FLOAT: return s->v.f;
+        default: return atof(s->str);
+    }
+}
+
+template<> inline double ConfigStore::as<double>(const cfg_slot_t *s){
+    return as<float>(s);
+}
+
+template<> inline bool ConfigStore::as<bool>(const cfg_slot_t *s){
+    if (!s) return false;
+    switch (s->type) {
+        case CFG_INT: return s->v.i;
+        case CFG_FLOAT: return s->v.f;
+        default: return !strcmp_P(s->str, P_true) || (s->str[0] == '1' && !s->str[1]);
+    }
+}
+
+template<> inline const char *ConfigStore::as<const char*>(const cfg_slot_t *s){
+    return s ? s->str : nullptr;
+}
+
+#endif
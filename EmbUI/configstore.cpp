@@ -0,0 +1,844 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "config.h"
+
+static char cfg_empty[1] = "";     // общее пустое значение, места в арене не занимает (см. assign())
+
+bool ConfigStore::keyeq(const cfg_slot_t *s, const cfgkey_t &key){
+    if (!key.pgm) return s->pkey ? !strcmp_P(key.p, s->key) : !strcmp(key.p, s->key);
+    if (!s->pkey) return !strcmp_P(s->key, key.p);
+    if (s->key == key.p) return true;
+
+    // одинаковые строки в разных местах PROGMEM, например FPSTR(P_xxx) и F("xxx")
+    PGM_P a = s->key;
+    PGM_P b = key.p;
+    uint8_t c;
+    do {
+        c = pgm_read_byte(a++);
+        if (c != pgm_read_byte(b++)) return false;
+    } while (c);
+    return true;
+}
+
+ConfigStore::cfg_slot_t *ConfigStore::find(const cfgkey_t &key){
+    if (!key.p) return nullptr;
+    // промах не регистрирует пространство: их заводят только create() и загрузка файлов
+    if (nshards) load(shardof(key, false));
+    return lookup(key);
+}
+
+ConfigStore::cfg_slot_t *ConfigStore::lookup(const cfgkey_t &key){
+    if (!key.p) return nullptr;
+    uint32_t h = key.hash();
+    if (idx) {
+        for (uint16_t b = h & (idxsize - 1); idx[b]; b = (b + 1) & (idxsize - 1)) {
+            cfg_slot_t *s = &slots[idx[b] - 1];
+            if (s->hash == h && keyeq(s, key)) return s;
+        }
+        return nullptr;
+    }
+    // индекс не выделился, перебор
+    for (uint16_t i = 0; i < cnt; i++) {
+        if (slots[i].hash == h && keyeq(&slots[i], key)) return &slots[i];
+    }
+    return nullptr;
+}
+
+void ConfigStore::idxput(uint16_t i){
+    uint16_t b = slots[i].hash & (idxsize - 1);
+    while (idx[b]) b = (b + 1) & (idxsize - 1);
+    idx[b] = i + 1;
+}
+
+/**
+ * перестроить индекс под текущее число слотов, вызывается при росте таблицы и после удаления слотов
+ */
+void ConfigStore::reindex(){
+    uint16_t size = 16;
+    while (size < cnt * 2) size <<= 1;
+    if (size != idxsize) {
+        free(idx);
+        idx = (uint16_t*)malloc(size * sizeof(uint16_t));
+        idxsize = idx ? size : 0;
+        if (!idx) return;
+    }
+    memset(idx, 0, idxsize * sizeof(uint16_t));
+    for (uint16_t i = 0; i < cnt; i++) idxput(i);
+}
+
+/**
+ * пространство имен ключа "ns/key"
+ * @param reg   зарегистрировать новое пространство
+ * @return 0 - основной конфиг (нет '/', длинное имя, пространство неизвестно или таблица пространств заполнена)
+ */
+uint8_t ConfigStore::shardof(const cfgkey_t &key, bool reg){
+    char ns[CFG_NS_LEN];
+    uint8_t i = 0;
+    char c;
+    while ((c = key.pgm ? pgm_read_byte(key.p + i) : key.p[i]) && c != '/') {
+        if (i == CFG_NS_LEN - 1) return 0;
+        ns[i++] = c;
+    }
+    if (!c || !i) return 0;
+    ns[i] = '\0';
+
+    for (uint8_t n = 0; n < nshards; n++) {
+        if (!strcmp(shards[n].name, ns)) return n + 1;
+    }
+    if (!reg || nshards == EMBUI_CFG_SHARDS) return 0;
+    cfg_shard_t &sh = shards[nshards++];
+    memcpy(sh.name, ns, i + 1);
+    sh.lastuse = millis();
+    sh.loaded = false;
+    sh.dirty = false;
+    return nshards;
+}
+
+bool ConfigStore::load(uint8_t shard){
+    if (!shard || shard > nshards) return false;
+    cfg_shard_t &sh = shards[shard - 1];
+    sh.lastuse = millis();
+    if (sh.loaded) return false;
+    sh.loaded = true;       // до загрузки: fromJson() сам ищет ключи этого пространства
+    // прочитанный файл не делает пространство измененным, изменения до загрузки сохраняются
+    bool dirty = sh.dirty;
+    if (loader) loader(*this, shard);
+    sh.dirty = dirty;
+    return true;
+}
+
+ConfigStore::cfg_slot_t *ConfigStore::add(const cfgkey_t &key, uint32_t hash){
+    if (cnt == cap) {
+        cfg_slot_t *p = (cfg_slot_t*)realloc(slots, (cap + EMBUI_CFG_GROW) * sizeof(cfg_slot_t));
+        if (!p) return nullptr;
+        slots = p;
+        cap += EMBUI_CFG_GROW;
+    }
+
+    // длиннее ключ не запишется в журнал и /config.bin, такой ключ не создается вовсе
+    size_t len = key.pgm ? strlen_P(key.p) : strlen(key.p);
+    if (len > CFG_KEY_LEN) {
+        LOG(printf_P, PSTR("UI: config key is longer than %u bytes, ignored\n"), CFG_KEY_LEN);
+        return nullptr;
+    }
+
+    cfg_slot_t *s = &slots[cnt];
+    memset(s, 0, sizeof(cfg_slot_t));
+    s->pkey = key.pgm;
+    if (key.pgm) {
+        s->key = key.p;
+    } else {
+        char *k = strings.alloc(len);
+        if (!k) return nullptr;
+        memcpy(k, key.p, len + 1);
+        s->key = k;
+    }
+    s->str = cfg_empty;
+    s->hash = hash;
+    s->shard = shardof(key, true);
+    ++cnt;
+    if (idx && cnt * 2 <= idxsize) idxput(cnt - 1);
+    else reindex();
+    return s;
+}
+
+ConfigStore::cfg_slot_t *ConfigStore::create(const cfgkey_t &key, const char *value, uint8_t type){
+    // значение по-умолчанию не требует загрузки пространства: файл, загруженный позже, его перекроет
+    cfg_slot_t *s = lookup(key);
+    if (s) {
+        // ключ, прочитанный из файла, теперь известен как PROGMEM-константа
+        if (key.pgm && !s->pkey) {
+            strings.release(s->key);
+            s->key = key.p;
+            s->pkey = true;
+        }
+        if (s->type != type) {
+            s->type = type;
+            parse(s);
+        }
+        return s;
+    }
+
+    s = add(key, key.hash());
+    if (!s) return nullptr;
+    s->type = type;
+    if (!s->shard) {
+        set(s, value);
+        return s;
+    }
+    // значение по умолчанию не делает пространство измененным: иначе оно переписывается и не выгружается
+    if (value && *value && !assign(s, value, strlen(value), nullptr)) return s;
+    s->dflt = true;
+    return s;
+}
+
+void ConfigStore::parse(cfg_slot_t *s){
+    switch (s->type) {
+        case CFG_INT: s->v.i = atol(s->str); break;
+        case CFG_FLOAT: s->v.f = atof(s->str); break;
+        default: break;
+    }
+}
+
+bool ConfigStore::set(cfg_slot_t *s, const char *value, char **old){
+    if (!value) value = "";
+    if (!strcmp(s->str, value)) return false;
+    if (!assign(s, value, strlen(value), old)) return false;
+    s->dirty = true;
+    s->dflt = false;
+    if (s->shard) shards[s->shard - 1].dirty = true;
+    return true;
+}
+
+/**
+ * записать len символов value в слот: на месте или в новое место арены
+ */
+bool ConfigStore::assign(cfg_slot_t *s, const char *value, size_t len, char **old){
+    if (!len) {
+        if (old) *old = s->str;
+        else strings.release(s->str);
+        s->str = cfg_empty;
+        parse(s);
+        return true;
+    }
+
+    // на месте, только если строка помещается и не занимает заметно меньше прежнего
+    size_t cap = strings.capacity(s->str);
+    if (old || cap <= len || cap > 2 * len + 16) {
+        char *p = strings.alloc(len);
+        if (!p) return false;
+        if (old) *old = s->str;
+        else strings.release(s->str);
+        s->str = p;
+    }
+    memcpy(s->str, value, len);
+    s->str[len] = '\0';
+    parse(s);
+    relocate();
+    return true;
+}
+
+/**
+ * перенести живые строки из замусоренной страницы в текущую, после чего она освобождается
+ * проход по слотам - только когда таких страниц набралось EMBUI_CFG_SPARSE, и каждый освобождает одну,
+ * так что обычная запись значения слоты не перебирает
+ */
+void ConfigStore::relocate(){
+    if (strings.sparsepages() < EMBUI_CFG_SPARSE) return;
+    const char *lo, *hi;
+    size_t left = strings.sparse(&lo, &hi);
+    if (!left) return;
+
+    for (uint16_t i = 0; i < cnt && left; i++) {
+        cfg_slot_t *s = &slots[i];
+        for (uint8_t f = 0; f < 2 && left; f++) {
+            const char *p = f ? s->str : s->key;
+            if ((!f && s->pkey) || p < lo || p >= hi) continue;
+
+            // после переноса последней живой строки страница освобождается, дальше ее адреса не трогаем
+            size_t len = strlen(p);
+            char *n = strings.alloc(len);
+            if (!n) return;
+            memcpy(n, p, len + 1);
+            left -= strings.capacity(p) + sizeof(uint16_t);
+            strings.release(p);
+            if (f) s->str = n; else s->key = n;
+        }
+    }
+}
+
+const char *ConfigStore::keyname(const cfg_slot_t *s, char *buf, size_t len){
+    if (!s->pkey) return s->key;
+    strncpy_P(buf, s->key, len - 1);
+    buf[len - 1] = '\0';
+    return buf;
+}
+
+void ConfigStore::printStr(Print &out, const char *s, bool pgm){
+    out.write('"');
+    char c;
+    while ((c = pgm ? pgm_read_byte(s) : *s)) {
+        ++s;
+        switch (c) {
+            case '"': out.print(F("\\\"")); break;
+            case '\\': out.print(F("\\\\")); break;
+            case '\n': out.print(F("\\n")); break;
+            case '\r': out.print(F("\\r")); break;
+            case '\t': out.print(F("\\t")); break;
+            default:
+                if ((uint8_t)c < 0x20) out.printf_P(PSTR("\\u%04x"), c);
+                else out.write(c);
+        }
+    }
+    out.write('"');
+}
+
+void ConfigStore::printTo(Print &out, uint8_t shard){
+    cfg_cursor_t c = cursor(CFG_OUT_JSON, shard);
+    while (print(out, c));
+}
+
+void ConfigStore::fromJson(JsonObjectConst obj){
+    char buf[24];
+    for (JsonPairConst kv : obj) {
+        const char *value = kv.value().as<const char*>();
+        if (!value && !kv.value().isNull()) {
+            // число или bool в файле, сохранённом вручную
+            serializeJson(kv.value(), buf, sizeof(buf));
+            value = buf;
+        }
+        cfg_slot_t *s = lookup(kv.key().c_str());
+        if (!s) s = add(kv.key().c_str(), embui_hash(kv.key().c_str()));
+        if (!s) continue;
+        set(s, value);
+        // ключ пространства имен из старого /config.json остается измененным, чтобы попасть в свой файл
+        if (!s->shard || shards[s->shard - 1].loaded) s->dirty = false;
+    }
+}
+
+bool CfgObservers::add(const cfgkey_t &key, cfgObserver cb, bool prefix){
+    if (nobs == EMBUI_CFG_OBSERVERS || !cb) return false;
+    observer_t &o = obs[nobs++];
+    o.key = key.p;
+    o.pgm = key.pgm;
+    o.hash = key.hash();
+    o.cb = cb;
+    o.len = prefix ? (key.pgm ? strlen_P(key.p) : strlen(key.p)) : 0;
+    return true;
+}
+
+bool CfgObservers::match(const observer_t &o, const ConfigStore::cfg_slot_t *s, const char *key) const {
+    if (!o.len) {
+        cfgkey_t k(o.key);
+        k.pgm = o.pgm;
+        return o.hash == s->hash && ConfigStore::keyeq(s, k);
+    }
+    return o.pgm ? !strncmp_P(key, o.key, o.len) : !strncmp(key, o.key, o.len);
+}
+
+bool CfgObservers::watched(const ConfigStore::cfg_slot_t *s) const {
+    if (!nobs) return false;
+    char buf[64];
+    const char *key = ConfigStore::keyname(s, buf, sizeof(buf));
+    for (uint8_t i = 0; i < nobs; i++) {
+        if (match(obs[i], s, key)) return true;
+    }
+    return false;
+}
+
+void CfgObservers::changed(ConfigStore &store, const ConfigStore::cfg_slot_t *s, char *old){
+    uint16_t slot = store.index(s);
+    for (uint16_t i = 0; i < nchanges + nspill; i++) {
+        if ((i < nchanges ? changes[i] : spill[i - nchanges]).slot != slot) continue;
+        store.release(old);     // в пачке остается значение до первого изменения
+        return;
+    }
+    if (nchanges < EMBUI_CFG_CHANGES) {
+        changes[nchanges].slot = slot;
+        changes[nchanges].old = old;
+        ++nchanges;
+        return;
+    }
+
+    // таблица заполнена: пачка растет в куче, рассылка все равно из handle(), а не изнутри var()
+    if (nspill == spillcap) {
+        change_t *p = (change_t*)realloc(spill, (spillcap + EMBUI_CFG_CHANGES) * sizeof(change_t));
+        if (!p) {
+            LOG(println, F("UI: no memory for config change, observers skip it"));
+            store.release(old);
+            return;
+        }
+        spill = p;
+        spillcap += EMBUI_CFG_CHANGES;
+    }
+    spill[nspill].slot = slot;
+    spill[nspill].old = old;
+    ++nspill;
+}
+
+void CfgObservers::dispatch(ConfigStore &store){
+    if (!nchanges && !nspill) return;
+
+    // наблюдатели могут менять конфиг, эти изменения уйдут следующей пачкой
+    change_t batch[EMBUI_CFG_CHANGES];
+    uint8_t n = nchanges;
+    memcpy(batch, changes, sizeof(change_t) * n);
+    nchanges = 0;
+    change_t *more = spill;
+    uint16_t nmore = nspill;
+    spill = nullptr;
+    nspill = spillcap = 0;
+
+    char key[CFG_KEY_LEN + 1];
+    for (uint16_t c = 0; c < n + nmore; c++) {
+        const change_t &ch = c < n ? batch[c] : more[c - n];
+        ConfigStore::cfg_slot_t *s = store.at(ch.slot);
+        if (s && strcmp(s->str, ch.old)) {
+            // копия: var() из обработчика может перенести ключ в арене
+            const char *k = ConfigStore::keyname(s, key, sizeof(key));
+            if (k != key) strcpy(key, k);
+            for (uint8_t i = 0; i < nobs; i++) {
+                if (!match(obs[i], s, key)) continue;
+                obs[i].cb(key, ch.old, s->str);
+                s = store.at(ch.slot);      // обработчик мог создать ключ и сдвинуть таблицу
+            }
+        }
+        store.release(ch.old);
+    }
+    free(more);
+}
+
+uint32_t cfg_crc32(uint32_t crc, const uint8_t *data, size_t len){
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+bool ConfigStore::print(Print &out, cfg_cursor_t &c, Print *bin){
+    if (c.done) return false;
+
+    // следующий слот, который попадает в вывод
+    cfg_slot_t *s = nullptr;
+    for (; c.slot < cnt; c.slot++) {
+        s = &slots[c.slot];
+        if (c.shard != CFG_SHARD_ALL && s->shard != c.shard) continue;
+        if (c.fmt == CFG_OUT_JOURNAL && (!s->dirty || strlen(s->str) > 0xFFFF)) continue;    // длинное значение попадет только в снимок
+        break;
+    }
+
+    if (c.slot >= cnt) {
+        c.done = true;
+        if (c.fmt == CFG_OUT_JSON) {
+            if (!c.count) out.write('{');
+            out.write('}');
+        }
+        return false;
+    }
+    ++c.slot;
+    ++c.count;
+
+    if (c.fmt == CFG_OUT_JSON) {
+        out.write(c.count == 1 ? '{' : ',');
+        printStr(out, s->key, s->pkey);
+        out.write(':');
+        printStr(out, s->str, false);
+        if (!bin) return true;
+    }
+
+    char kbuf[CFG_KEY_LEN + 1];
+    const char *key = keyname(s, kbuf, sizeof(kbuf));
+    size_t klen = strlen(key), vlen = strlen(s->str);
+
+    if (c.fmt == CFG_OUT_JOURNAL) {
+        uint8_t hdr[4] = { CFG_JOURNAL_MAGIC, (uint8_t)klen, (uint8_t)(vlen & 0xFF), (uint8_t)(vlen >> 8) };
+        uint32_t crc = cfg_crc32(0, hdr, sizeof(hdr));
+        crc = cfg_crc32(crc, (const uint8_t*)key, klen);
+        crc = cfg_crc32(crc, (const uint8_t*)s->str, vlen);
+        uint8_t tail[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+
+        // неудачная запись оставляет слот измененным
+        if (out.write(hdr, sizeof(hdr)) == sizeof(hdr)
+            && out.write((const uint8_t*)key, klen) == klen
+            && out.write((const uint8_t*)s->str, vlen) == vlen
+            && out.write(tail, sizeof(tail)) == sizeof(tail)) s->dirty = false;
+        return true;
+    }
+
+    if (vlen > 0xFFFF) vlen = 0xFFFF;
+    uint8_t hdr[4] = { s->type, (uint8_t)klen, (uint8_t)(vlen & 0xFF), (uint8_t)(vlen >> 8) };
+    bin->write(hdr, sizeof(hdr));
+    bin->write((const uint8_t*)key, klen);
+    bin->write((const uint8_t*)s->str, vlen);
+    return true;
+}
+
+size_t ConfigStore::replay(Stream &in){
+    size_t applied = 0;
+    uint8_t hdr[4], tail[4];
+    char key[CFG_KEY_LEN + 1];
+
+    while (in.readBytes(hdr, sizeof(hdr)) == sizeof(hdr) && hdr[0] == CFG_JOURNAL_MAGIC) {
+        size_t klen = hdr[1], vlen = hdr[2] | (hdr[3] << 8);
+        char *value = (char*)malloc(vlen + 1);
+        if (!value) break;
+
+        bool ok = in.readBytes(key, klen) == klen
+            && in.readBytes(value, vlen) == vlen
+            && in.readBytes(tail, sizeof(tail)) == sizeof(tail);
+        if (ok) {
+            uint32_t crc = cfg_crc32(0, hdr, sizeof(hdr));
+            crc = cfg_crc32(crc, (const uint8_t*)key, klen);
+            crc = cfg_crc32(crc, (const uint8_t*)value, vlen);
+            ok = crc == (tail[0] | (tail[1] << 8) | ((uint32_t)tail[2] << 16) | ((uint32_t)tail[3] << 24));
+        }
+        if (!ok) {
+            // хвост, недописанный из-за пропадания питания
+            free(value);
+            break;
+        }
+
+        key[klen] = '\0';
+        value[vlen] = '\0';
+        cfg_slot_t *s = lookup(key);
+        if (!s) s = add(key, embui_hash(key));
+        if (s) {
+            set(s, value);
+            s->dirty = false;
+            ++applied;
+        }
+        free(value);
+    }
+    return applied;
+}
+
+bool ConfigStore::fromBin(const uint8_t *data, size_t len){
+    cfg_bintail_t hdr;
+    if (len < sizeof(hdr)) return false;
+    memcpy(&hdr, data + len - sizeof(hdr), sizeof(hdr));
+    if (hdr.magic != CFG_BIN_MAGIC || hdr.version != CFG_BIN_VERSION || hdr.bodylen != len - sizeof(hdr)) return false;
+
+    if (cfg_crc32(0, data, hdr.bodylen) != hdr.crc) return false;
+
+    // таблица слотов выделяется сразу под все ключи
+    if (hdr.count > cap) {
+        cfg_slot_t *p = (cfg_slot_t*)realloc(slots, hdr.count * sizeof(cfg_slot_t));
+        if (!p) return false;
+        slots = p;
+        cap = hdr.count;
+    }
+
+    const uint8_t *end = data + hdr.bodylen;
+    char key[CFG_KEY_LEN + 1];
+    for (uint16_t i = 0; i < hdr.count && data + 4 <= end; i++) {
+        uint8_t type = data[0];
+        size_t klen = data[1], vlen = data[2] | (data[3] << 8);
+        data += 4;
+        if (data + klen + vlen > end) break;
+
+        memcpy(key, data, klen);
+        key[klen] = '\0';
+        data += klen;
+
+        cfg_slot_t *s = lookup(key);
+        if (!s) s = add(key, embui_hash(key));
+        if (!s) break;
+        s->type = type;
+        assign(s, (const char*)data, vlen, nullptr);
+        s->dirty = false;
+        data += vlen;
+    }
+    return true;
+}
+
+bool ConfigStore::dirty() const {
+    for (uint16_t i = 0; i < cnt; i++) {
+        if (slots[i].dirty && !slots[i].shard) return true;
+    }
+    return false;
+}
+
+void ConfigStore::clean(uint8_t shard){
+    for (uint16_t i = 0; i < cnt; i++) {
+        if (slots[i].shard == shard) slots[i].dirty = false;
+    }
+    if (shard && shard <= nshards) shards[shard - 1].dirty = false;
+}
+
+uint8_t ConfigStore::dirtyshard() const {
+    for (uint8_t n = 0; n < nshards; n++) {
+        if (shards[n].dirty) return n + 1;
+    }
+    return 0;
+}
+
+uint8_t ConfigStore::lru() const {
+    uint8_t r = 0;
+    for (uint8_t n = 0; n < nshards; n++) {
+        if (!shards[n].loaded || shards[n].dirty) continue;
+        if (!r || (int32_t)(shards[n].lastuse - shards[r - 1].lastuse) < 0) r = n + 1;
+    }
+    return r;
+}
+
+bool ConfigStore::evict(uint8_t shard){
+    if (!shard || shard > nshards) return false;
+    cfg_shard_t &sh = shards[shard - 1];
+    if (!sh.loaded || sh.dirty) return false;
+
+    uint16_t j = 0;
+    for (uint16_t i = 0; i < cnt; i++) {
+        cfg_slot_t *s = &slots[i];
+        if (s->shard == shard && !s->dflt) {
+            if (!s->pkey) strings.release(s->key);
+            strings.release(s->str);
+            continue;
+        }
+        if (j != i) slots[j] = *s;
+        ++j;
+    }
+    cnt = j;
+    sh.loaded = false;
+    reindex();
+    return true;
+}
+
+void ConfigStore::clear(){
+    strings.clear();
+    free(slots);
+    slots = nullptr;
+    cnt = cap = 0;
+    nshards = 0;
+    free(idx);
+    idx = nullptr;
+    idxsize = 0;
+}
+
+size_t ConfigStore::memory() const {
+    return cap * sizeof(cfg_slot_t) + idxsize * sizeof(uint16_t) + strings.bytes();
+}
+
+CfgArena::cfg_page_t *CfgArena::page(const char *p) const {
+    for (cfg_page_t *pg = pages; pg; pg = pg->next) {
+        if (p >= pg->data && p < pg->data + pg->used) return pg;
+    }
+    return nullptr;
+}
+
+char *CfgArena::alloc(size_t len){
+    size_t need = (len + 2) & ~(size_t)1;       // строка с '\0', четное выравнивание для заголовка
+    size_t total = need + sizeof(uint16_t);
+    if (need > 0xFFFF) return nullptr;
+
+    if (!pages || (size_t)(pages->size - pages->used) < total) {
+        // новая текущая страница, длинная строка получает страницу под свой размер
+        size_t size = total > EMBUI_CFG_PAGE ? total : EMBUI_CFG_PAGE;
+        cfg_page_t *pg = (cfg_page_t*)malloc(sizeof(cfg_page_t) + size);
+        if (!pg) return nullptr;
+        pg->size = size;
+        pg->used = pg->live = 0;
+        if (pages && thin(pages)) ++nsparse;
+        pg->next = pages;
+        pages = pg;
+        ++npages;
+    }
+
+    char *p = pages->data + pages->used;
+    uint16_t cap = need;
+    memcpy(p, &cap, sizeof(cap));
+    pages->used += total;
+    pages->live += total;
+    return p + sizeof(uint16_t);
+}
+
+void CfgArena::release(const char *p){
+    cfg_page_t *pg = page(p);
+    if (!pg) return;
+
+    uint16_t cap;
+    memcpy(&cap, p - sizeof(uint16_t), sizeof(cap));
+    bool was = pg != pages && thin(pg);
+    pg->live -= cap + sizeof(uint16_t);
+    if (pg->live) {
+        if (pg != pages && !was && thin(pg)) ++nsparse;
+        return;
+    }
+    if (was) --nsparse;
+
+    if (pg == pages) {
+        pg->used = 0;       // текущая страница остается для следующих строк
+        return;
+    }
+    for (cfg_page_t **pp = &pages; *pp; pp = &(*pp)->next) {
+        if (*pp != pg) continue;
+        *pp = pg->next;
+        free(pg);
+        --npages;
+        break;
+    }
+}
+
+size_t CfgArena::capacity(const char *p) const {
+    if (!page(p)) return 0;
+    uint16_t cap;
+    memcpy(&cap, p - sizeof(uint16_t), sizeof(cap));
+    return cap;
+}
+
+size_t CfgArena::sparse(const char **lo, const char **hi) const {
+    if (!pages) return 0;
+    for (cfg_page_t *pg = pages->next; pg; pg = pg->next) {
+        if (!thin(pg)) continue;
+        *lo = pg->data;
+        *hi = pg->data + pg->used;
+        return pg->live;
+    }
+    return 0;
+}
+
+void CfgArena::clear(){
+    while (pages) {
+        cfg_page_t *pg = pages;
+        pages = pg->next;
+        free(pg);
+    }
+    npages = nsparse = 0;
+}
+
+size_t CfgArena::bytes() const {
+    size_t n = 0;
+    for (cfg_page_t *pg = pages; pg; pg = pg->next) n += sizeof(cfg_page_t) + pg->size;
+    return n;
+}
+
+size_t CfgArena::live() const {
+    size_t n = 0;
+    for (cfg_page_t *pg = pages; pg; pg = pg->next) n += pg->live;
+    return n;
+}
+
+size_t CfgArena::garbage() const {
+    size_t n = 0;
+    for (cfg_page_t *pg = pages; pg; pg = pg->next) n += pg->used - pg->live;
+    return n;
+}
+
+bool CfgFile::open(const String &path, const char *mode){
+    file = LittleFS.open(path, mode);
+    len = flushed = 0;
+    crc = 0;
+    err = !file;
+    return !err;
+}
+
+size_t CfgFile::write(const uint8_t *data, size_t size){
+    if (err) return 0;
+    crc = cfg_crc32(crc, data, size);
+    size_t done = 0;
+    while (done < size) {
+        size_t n = size - done;
+        if (n > sizeof(buf) - len) n = sizeof(buf) - len;
+        memcpy(buf + len, data + done, n);
+        len += n;
+        done += n;
+        if (len == sizeof(buf)) flush();
+        if (err) return 0;
+    }
+    return size;
+}
+
+void CfgFile::flush(){
+    if (!len || err) return;
+    if (file.write((const uint8_t*)buf, len) != len) err = true;
+    flushed += len;
+    len = 0;
+}
+
+void CfgFile::close(){
+    flush();
+    file.close();
+}
+
+bool CfgWriter::begin(const String &path, const __FlashStringHelper *tmp){
+    abort();
+    // PSTR("w") использовать нельзя, будет исключение!
+    if (!out.open(tmp ? String(tmp) : path, tmp ? "w" : "a")) return false;
+    tmpfile = tmp;
+    target = tmp ? path : String();
+    store = nullptr;
+    active = true;
+    return true;
+}
+
+bool CfgWriter::mirror(const __FlashStringHelper *path, const __FlashStringHelper *tmp){
+    if (!active || !bin.open(String(tmp), "w")) return false;
+    bintmp = tmp;
+    bintarget = path;
+    return true;
+}
+
+/**
+ * дописать завершающий блок двоичного снимка: число записей, их crc и crc основного файла
+ */
+bool CfgWriter::finishbin(){
+    ConfigStore::cfg_bintail_t tail;
+    tail.magic = CFG_BIN_MAGIC;
+    tail.version = CFG_BIN_VERSION;
+    tail.reserved = 0;
+    tail.count = cur.count;
+    tail.jsonsize = out.size();
+    tail.jsoncrc = out.crc;
+    tail.bodylen = bin.size();
+    tail.crc = bin.crc;
+    bin.write((const uint8_t*)&tail, sizeof(tail));
+    bin.close();
+    return !bin.err;
+}
+
+int8_t CfgWriter::step(){
+    if (!active) return 0;
+
+    // записи печатаются, пока буфер хотя бы раз не уйдет в файл
+    size_t was = out.flushed;
+    while (store && !out.err && out.flushed == was) {
+        if (!store->print(out, cur, bintmp ? &bin : nullptr)) store = nullptr;
+    }
+    if (store && !out.err) return 1;
+    out.close();
+
+    bool err = out.err;
+    bool binok = bintmp && !err && finishbin();
+    if (tmpfile) {
+        bool retired = false;
+        if (!err && retfrom && LittleFS.exists(retfrom)) {
+            retired = LittleFS.rename(retfrom, retto);
+            err = !retired;
+        }
+        if (err || !LittleFS.rename(tmpfile, target)) {
+            if (retired) LittleFS.rename(retto, retfrom);
+            LittleFS.remove(tmpfile);
+            err = true;
+        }
+    }
+    // двоичный снимок только вслед за основным файлом, с которым он сверяется
+    if (bintmp && (err || !binok || !LittleFS.rename(bintmp, bintarget))) {
+        bin.file.close();
+        LittleFS.remove(bintmp);
+    }
+
+    release();
+    return err ? -1 : 0;
+}
+
+void CfgWriter::abort(){
+    if (!active) return;
+    out.file.close();
+    if (tmpfile) LittleFS.remove(tmpfile);
+    if (bintmp) {
+        bin.file.close();
+        LittleFS.remove(bintmp);
+    }
+    release();
+}
+
+void CfgWriter::release(){
+    store = nullptr;
+    target = String();
+    tmpfile = nullptr;
+    retfrom = retto = nullptr;
+    bintmp = bintarget = nullptr;
+    active = false;
+}
+
+void CfgWriter::loop_time(uint32_t us){
+    uint32_t ms = us / 1000;
+    uint8_t i = 0;
+    while (i < CFG_LOOP_HIST - 1 && ms >= (1UL << i)) ++i;
+    ++hist[i];
+    if (us > loop_max) loop_max = us;
+}
@@ -35,6 +35,12 @@ static const char P_wifi[] PROGMEM = "wifi";
 
 // System config variables
 static const char P_cfgfile[] PROGMEM = "/config.json";
+static const char P_cfgjournal[] PROGMEM = "/config.jnl";      // журнал изменений поверх /config.json
+static const char P_cfgjnlold[] PROGMEM = "/config.jno";       // журнал, уже свернутый в /config.tmp, до переименования снимка
+static const char P_cfgtmp[] PROGMEM = "/config.tmp";          // временный файл для атомарной записи снимка
+static const char P_cfgbin[] PROGMEM = "/config.bin";          // двоичная копия /config.json для быстрой загрузки
+static const char P_cfgbintmp[] PROGMEM = "/config.bit";        // временный файл двоичной копии
+static const char P_cfgshard[] PROGMEM = "/cfg_%s.json";       // файл пространства имен ключей "ns/..."
 
 static const char P_APonly[] PROGMEM = "APonly";
 static const char P_APpwd[] PROGMEM = "APpwd";
@@ -0,0 +1,143 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "framecache.h"
+
+void FrameCache::release(cache_entry_t *entry){
+    cache_frame_t *f = entry->frames;
+    while (f) {
+        cache_frame_t *next = f->next;
+        free(f);
+        f = next;
+    }
+    delete entry;
+}
+
+void FrameCache::drop(const String &name){
+    for (int i = entries.size() - 1; i >= 0; --i) {
+        if (entries[i]->name != name) continue;
+        cache_entry_t *entry = entries.remove(i);
+        total -= entry->len;
+        release(entry);
+    }
+}
+
+bool FrameCache::replay(const String &name, AsyncWebSocketClient *client){
+    for (int i = 0; i < entries.size(); i++) {
+        cache_entry_t *entry = entries[i];
+        if (entry->gen != gen || entry->name != name) continue;
+
+        LOG(printf_P, PSTR("UI: frame cache replay %s (%u bytes)\n"), name.c_str(), entry->len);
+        for (cache_frame_t *f = entry->frames; f; f = f->next) {
+            client->text(f->data, f->len);
+            METRIC_INC(M_WS_OUT_MSGS);
+            METRIC_ADD(M_WS_OUT_BYTES, f->len);
+        }
+        return true;
+    }
+    return false;
+}
+
+void FrameCache::begin(const String &name){
+    abort();
+    drop(name);
+
+    rec = new cache_entry_t;
+    rec->name = name;
+    rec->gen = gen;
+    rec->frames = rec->tail = nullptr;
+    rec->len = 0;
+    rec->ndeps = 0;
+    rec->alldeps = false;
+}
+
+void FrameCache::end(){
+    if (!rec) return;
+    LOG(printf_P, PSTR("UI: frame cache store %s (%u bytes, %u deps)\n"), rec->name.c_str(), rec->len, rec->ndeps);
+    total += rec->len;
+    entries.add(rec);
+    rec = nullptr;
+}
+
+void FrameCache::abort(){
+    if (!rec) return;
+    release(rec);
+    rec = nullptr;
+}
+
+char *FrameCache::reserve(size_t len){
+    if (!rec) return nullptr;
+    if (total + rec->len + len > EMBUI_FRAMECACHE_SIZE) {
+        LOG(printf_P, PSTR("UI: frame cache overflow %s\n"), rec->name.c_str());
+        abort();
+        return nullptr;
+    }
+
+    cache_frame_t *f = (cache_frame_t*)malloc(sizeof(cache_frame_t) + len + 1);
+    if (!f) {
+        abort();
+        return nullptr;
+    }
+    f->next = nullptr;
+    f->len = len;
+    if (rec->tail) rec->tail->next = f; else rec->frames = f;
+    rec->tail = f;
+    rec->len += len;
+    return f->data;
+}
+
+void FrameCache::depend(const char *key){
+    if (rec && key) depend(embui_hash(key));
+}
+
+void FrameCache::depend(uint32_t h){
+    if (!rec) return;
+    for (uint8_t i = 0; i < rec->ndeps; i++) {
+        if (rec->deps[i] == h) return;
+    }
+    if (rec->ndeps == FRAMECACHE_DEPS) {
+        rec->alldeps = true;
+        return;
+    }
+    rec->deps[rec->ndeps++] = h;
+}
+
+void FrameCache::changed(const char *key){
+    if (entries.size() || rec) changed(embui_hash(key));
+}
+
+void FrameCache::changed(uint32_t h){
+    if (!entries.size() && !rec) return;
+
+    if (rec) {
+        for (uint8_t i = 0; i < rec->ndeps; i++) {
+            if (rec->deps[i] == h) { abort(); break; }
+        }
+    }
+
+    for (int i = entries.size() - 1; i >= 0; --i) {
+        cache_entry_t *entry = entries[i];
+        bool hit = entry->alldeps || entry->gen != gen;
+        for (uint8_t n = 0; !hit && n < entry->ndeps; n++) {
+            hit = entry->deps[n] == h;
+        }
+        if (!hit) continue;
+
+        LOG(printf_P, PSTR("UI: frame cache drop %s by key %08x\n"), entry->name.c_str(), h);
+        entries.remove(i);
+        total -= entry->len;
+        release(entry);
+    }
+}
+
+void FrameCache::invalidate(){
+    ++gen;
+    abort();
+    while (entries.size()) {
+        cache_entry_t *entry = entries.shift();
+        release(entry);
+    }
+    total = 0;
+}
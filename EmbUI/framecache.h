@@ -0,0 +1,90 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+#include "LList.h"
+#include "metrics.h"
+
+#ifdef ESP8266
+ #include <ESPAsyncTCP.h>
+#else
+ #include <AsyncTCP.h>
+#endif
+#include <ESPAsyncWebServer.h>
+
+#ifndef EMBUI_FRAMECACHE_SIZE
+#define EMBUI_FRAMECACHE_SIZE   (4096U)     // предельный объем сериализованных фреймов в кэше, байт
+#endif
+
+#define FRAMECACHE_DEPS         (24U)       // сколько ключей конфига отслеживается для одной секции
+
+/**
+ * Кэш сериализованных фреймов интерфейса
+ * секция записывается при первом построении и затем отдается новым клиентам без вызова построителей.
+ * Запись привязана к имени секции и поколению кэша, сбрасывается через invalidate()
+ * или при изменении через EmbUI::var() любого ключа, прочитанного построителем через param()
+ *
+ * Кэшируемая секция должна быть чистой функцией param(): состояние вне конфига (WiFi, время, датчики)
+ * в ней допустимо, только если его смена вызывает invalidate(), как смена режима WiFi и подключение к AP.
+ * Побочные действия построителя (сброс таймеров и т.п.) при отдаче из кэша не выполняются
+ */
+class FrameCache {
+    typedef struct cache_frame_t {
+        cache_frame_t *next;
+        size_t len;
+        char data[];
+    } cache_frame_t;
+
+    typedef struct cache_entry_t {
+        String name;
+        uint32_t gen;
+        cache_frame_t *frames;
+        cache_frame_t *tail;
+        size_t len;
+        uint32_t deps[FRAMECACHE_DEPS];     // хэши ключей, от которых зависит секция
+        uint8_t ndeps;
+        bool alldeps;                       // список зависимостей переполнен, сбрасываемся на любое изменение
+    } cache_entry_t;
+
+    LList<cache_entry_t*> entries;
+    cache_entry_t *rec = nullptr;           // секция в процессе записи
+    uint32_t gen = 0;
+    size_t total = 0;
+
+    void release(cache_entry_t *entry);
+    void drop(const String &name);
+
+  public:
+    FrameCache() : entries() {}
+
+    /**
+     * отправить клиенту секцию из кэша
+     * @return false если секции нет в кэше
+     */
+    bool replay(const String &name, AsyncWebSocketClient *client);
+
+    /**
+     * начать запись секции, фреймы добавляются через reserve()
+     */
+    void begin(const String &name);
+    void end();
+    void abort();
+
+    /**
+     * выделить место под фрейм длиной len в записываемой секции
+     * @return nullptr если запись не ведется или превышен лимит EMBUI_FRAMECACHE_SIZE
+     */
+    char *reserve(size_t len);
+
+    bool recording() const { return rec != nullptr; }
+    void depend(const char *key);
+    void depend(uint32_t hash);         // hash = embui_hash(key)
+    void changed(const char *key);
+    void changed(uint32_t hash);
+    void invalidate();
+    size_t size() const { return total; }
+};
@@ -0,0 +1,56 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "framepool.h"
+
+FramePool framepool;
+
+// буферы берутся и из других задач ESP32 (собственные фреймы приложения), список слотов защищен
+#ifdef ESP32
+ #define FP_LOCK()   portENTER_CRITICAL(&mux)
+ #define FP_UNLOCK() portEXIT_CRITICAL(&mux)
+#else
+ #define FP_LOCK()
+ #define FP_UNLOCK()
+#endif
+
+void FramePool::begin(){
+    for (uint8_t i = 0; i < EMBUI_FRAMEPOOL_SLOTS; i++) {
+        if (!slots[i]) slots[i] = (char*)malloc(EMBUI_FRAMEPOOL_SIZE);
+    }
+}
+
+char *FramePool::lease(size_t size){
+    if (size <= EMBUI_FRAMEPOOL_SIZE) {
+        FP_LOCK();
+        for (uint8_t i = 0; i < EMBUI_FRAMEPOOL_SLOTS; i++) {
+            if (!slots[i] || busy & (1 << i)) continue;
+            busy |= 1 << i;
+            ++stat.hits;
+            if (++stat.used > stat.peak) stat.peak = stat.used;
+            FP_UNLOCK();
+            return slots[i];
+        }
+        FP_UNLOCK();
+    }
+    FP_LOCK();
+    ++stat.misses;
+    FP_UNLOCK();
+    return (char*)malloc(size);
+}
+
+void FramePool::release(char *buf){
+    if (!buf) return;
+    FP_LOCK();
+    for (uint8_t i = 0; i < EMBUI_FRAMEPOOL_SLOTS; i++) {
+        if (slots[i] != buf) continue;
+        busy &= ~(1 << i);
+        --stat.used;
+        FP_UNLOCK();
+        return;
+    }
+    FP_UNLOCK();
+    free(buf);
+}
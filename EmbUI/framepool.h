@@ -0,0 +1,70 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+#include <ArduinoJson.h>
+
+#ifndef EMBUI_FRAMEPOOL_SLOTS
+#define EMBUI_FRAMEPOOL_SLOTS   2       // сколько буферов фреймов резервируется в begin(), 0 - пул выключен, не больше 8
+#endif
+
+#ifndef EMBUI_FRAMEPOOL_SIZE
+#define EMBUI_FRAMEPOOL_SIZE    3000    // размер буфера, байт; равен размеру документа Interface по умолчанию
+#endif
+
+/**
+ * Пул буферов для документов Interface
+ * буферы выделяются один раз в begin() и дальше только выдаются и возвращаются, куча не дробится на каждый фрейм.
+ * Два слота покрывают вложенность "секция строит фрейм и вызывает CALL_INTF", если все слоты заняты
+ * или запрошен документ больше слота, буфер выделяется из кучи как раньше (промах)
+ */
+class FramePool {
+  public:
+    typedef struct framepool_stat_t {
+        uint32_t hits;          // буфер выдан из пула
+        uint32_t misses;        // пул занят или документ не помещается, буфер из кучи
+        uint8_t used;           // слотов занято сейчас
+        uint8_t peak;           // максимум занятых слотов
+    } framepool_stat_t;
+
+  private:
+    char *slots[EMBUI_FRAMEPOOL_SLOTS ? EMBUI_FRAMEPOOL_SLOTS : 1] = {};
+    uint8_t busy = 0;           // битовая маска занятых слотов
+    framepool_stat_t stat = {};
+#ifdef ESP32
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+  public:
+    /**
+     * зарезервировать буферы, вызывается из EmbUI::begin(); до этого все документы выделяются из кучи
+     */
+    void begin();
+
+    /**
+     * буфер под документ размером size: слот пула или память из кучи
+     * @return nullptr, если в куче не нашлось места
+     */
+    char *lease(size_t size);
+
+    /**
+     * вернуть буфер: слот освобождается, память из кучи освобождается
+     */
+    void release(char *buf);
+
+    const framepool_stat_t &stats() const { return stat; }
+};
+
+extern FramePool framepool;
+
+/**
+ * JsonDocument поверх внешнего буфера, буфером владеет Interface
+ */
+class FrameDocument : public JsonDocument {
+  public:
+    FrameDocument(char *buf, size_t capa) : JsonDocument(buf, capa) {}
+};
@@ -20,4 +20,25 @@
 	#define LOG(func, ...) Serial.func(__VA_ARGS__)
 #else
 	#define LOG(func, ...) ;
-#endif
\ No newline at end of file
+#endif
+
+// FNV-1a хэш строки
+inline uint32_t embui_hash(const char *s){
+    uint32_t h = 2166136261UL;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+// FNV-1a хэш строки из PROGMEM, совпадает с embui_hash() для той же строки
+inline uint32_t embui_hash_P(PGM_P s){
+    uint32_t h = 2166136261UL;
+    uint8_t c;
+    while ((c = pgm_read_byte(s++))) {
+        h ^= c;
+        h *= 16777619UL;
+    }
+    return h;
+}
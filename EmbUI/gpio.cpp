@@ -13,46 +13,45 @@ void EmbUI::led_handle(){
         digitalWrite(sysData.LED_PIN, LOW + sysData.LED_INVERT);
 }
 
+bool btnCallback(uint8_t event){ return false; }
+
+/**
+ * опрос кнопки из планировщика раз в EMBUI_BTN_POLL
+ * события сначала получает btnCallback(), если он вернул true - действие по-умолчанию не выполняется
+ */
 void EmbUI::btn(){
 #ifdef __BUTTON
-    if (digitalRead(__BUTTON))
-        return;
-
-    uint8_t old_wifi_mode = wifi_mode;
+    btn_event_t ev = button.poll(!digitalRead(__BUTTON), millis());
+    if (ev == BTN_NONE || btnCallback(ev)) return;
 
-    led_inv();
-    unsigned long t = millis();
-    bool i = false;
-    while (!digitalRead(__BUTTON))
-    {
-        delay(1);
-        if (t + 5000 < millis()) // Нажатие 5 секунд
-        {
-            if(!i){
-                led_inv();
-                i = true;
-            }
-            if (old_wifi_mode == WIFI_STA)
-                wifi_mode = WIFI_AP;
-            if (old_wifi_mode == WIFI_AP)
-                wifi_mode = WIFI_STA;
-        }
-        if (t + 15000 < millis()) // Нажатие 10 секунд
-        {
-            led_inv();
-            LittleFS.remove(F("/config.json"));
-            ESP.restart();
-        }
-    }
-    if (wifi_mode != old_wifi_mode) // событие после отпуска кнопки от 5 секунд
-    {
+    switch (ev) {
+    case BTN_PRESS:
+        led_inv();
+        break;
+    case BTN_LONG:      // 5 секунд: режим WiFi переключается, применяется после отпускания
+        led_inv();
+        sysData.btn_wifi = wifi_mode == WIFI_STA || wifi_mode == WIFI_AP;
+        if (wifi_mode == WIFI_STA)
+            wifi_mode = WIFI_AP;
+        else if (wifi_mode == WIFI_AP)
+            wifi_mode = WIFI_STA;
+        break;
+    case BTN_LONG_RELEASE:
+        if (!sysData.btn_wifi) break;
+        sysData.btn_wifi = false;
         if (wifi_mode == WIFI_STA)
             var(FPSTR(P_wifi), F("AP"));
         if (wifi_mode == WIFI_AP)
             var(FPSTR(P_wifi), F("STA"));
-            // тут сохранить настройки
         wifi_connect();
-        //ESP.restart();
+        break;
+    case BTN_VERYLONG:  // 15 секунд: сброс конфига
+        led_inv();
+        cfg_erase();
+        ESP.restart();
+        break;
+    default:
+        break;
     }
 #endif
 }
@@ -6,4 +6,48 @@
 #ifndef gpio_h
 #define gpio_h
 
-#endif
\ No newline at end of file
+#include "globals.h"
+
+#ifndef EMBUI_BTN_POLL
+#define EMBUI_BTN_POLL      20      // период опроса кнопки, мс
+#endif
+
+#ifndef EMBUI_BTN_DEBOUNCE
+#define EMBUI_BTN_DEBOUNCE  40      // уровень должен держаться столько, чтобы считаться устойчивым, мс
+#endif
+
+#ifndef EMBUI_BTN_LONG
+#define EMBUI_BTN_LONG      5000    // долгое нажатие: переключение AP/STA, мс
+#endif
+
+#ifndef EMBUI_BTN_VERYLONG
+#define EMBUI_BTN_VERYLONG  15000   // очень долгое нажатие: сброс конфига, мс
+#endif
+
+typedef enum : uint8_t {
+    BTN_NONE = 0,
+    BTN_PRESS,          // кнопка нажата
+    BTN_SHORT,          // отпущена раньше EMBUI_BTN_LONG
+    BTN_LONG,           // удерживается EMBUI_BTN_LONG, приходит во время удержания
+    BTN_LONG_RELEASE,   // отпущена после BTN_LONG; после BTN_VERYLONG отпускание событий не дает
+    BTN_VERYLONG        // удерживается EMBUI_BTN_VERYLONG
+} btn_event_t;
+
+/**
+ * Кнопка с антидребезгом, без ожидания в цикле
+ * poll() вызывается периодически с текущим уровнем и временем и возвращает не больше одного события за вызов,
+ * интервалы считаются разностями millis()
+ */
+class Button {
+    uint32_t changed = 0;       // когда сырой уровень менялся последний раз
+    uint32_t pressed = 0;       // когда зафиксировано нажатие
+    bool raw = false;           // последний прочитанный уровень
+    bool down = false;          // устойчивое состояние после антидребезга
+    uint8_t stage = 0;          // сколько порогов удержания пройдено: 0, 1 - BTN_LONG, 2 - BTN_VERYLONG
+
+  public:
+    btn_event_t poll(bool level, uint32_t now);
+    bool isdown() const { return down; }
+};
+
+#endif
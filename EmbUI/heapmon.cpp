@@ -0,0 +1,223 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "heapmon.h"
+#include "MemoryInfo.h"
+#include "ui.h"
+#include <StreamString.h>
+
+#define SVG_STEP    10      // шаг графика по x
+#define SVG_H       100     // высота графика
+#define SVG_ROW     5       // полоса одной метки
+
+HeapMon heapmon;
+
+static const char P_ht_render[] PROGMEM = "render";
+static const char P_ht_post[] PROGMEM = "post";
+static const char P_ht_save[] PROGMEM = "save";
+static const char P_ht_mqtt[] PROGMEM = "mqtt";
+static const char P_ht_wsconn[] PROGMEM = "ws_connect";
+
+static const char *const heap_tag_names[HEAP_TAGS] PROGMEM = {
+    P_ht_render, P_ht_post, P_ht_save, P_ht_mqtt, P_ht_wsconn
+};
+
+static const char P_c_render[] PROGMEM = "#8e44ad";
+static const char P_c_post[] PROGMEM = "#e67e22";
+static const char P_c_save[] PROGMEM = "#16a085";
+static const char P_c_mqtt[] PROGMEM = "#7f8c8d";
+static const char P_c_wsconn[] PROGMEM = "#c0392b";
+
+static const char *const heap_tag_colors[HEAP_TAGS] PROGMEM = {
+    P_c_render, P_c_post, P_c_save, P_c_mqtt, P_c_wsconn
+};
+
+// линии графика: свободная память, наибольший блок, фрагментация
+static const char line_colors[3][8] PROGMEM = {"#2a7ae2", "#35a853", "#e24a2a"};
+static const char line_names[3][6] PROGMEM = {"free", "block", "frag%"};
+
+const __FlashStringHelper *HeapMon::name(uint8_t bit){
+    return FPSTR(pgm_read_ptr(&heap_tag_names[bit]));
+}
+
+void HeapMon::begin(){
+    timer.every(EMBUI_HEAPMON_PERIOD, [this](){ sample(); });
+}
+
+void HeapMon::mark(){
+    uint32_t f = ESP.getFreeHeap();
+    if (f < low) low = f;
+}
+
+void HeapMon::sample(){
+    size_t total, largest;
+    getMemoryInfo(total, largest);
+
+    heap_sample_t &s = ring[head];
+    s.ms = millis();
+    s.free = ESP.getFreeHeap();
+    s.minfree = low < s.free ? low : s.free;
+    s.block = largest;
+    s.frag = total ? 100 - (uint64_t)largest * 100 / total : 0;
+#ifdef ESP32
+    s.tags = __atomic_exchange_n(&seen, 0, __ATOMIC_RELAXED);
+#else
+    s.tags = seen;
+    seen = 0;
+#endif
+    low = UINT32_MAX;
+
+    head = (head + 1) % EMBUI_HEAPMON_DEPTH;
+    if (cnt < EMBUI_HEAPMON_DEPTH) ++cnt;
+
+    if (!live) return;
+    if (millis() - live > EMBUI_HEAPMON_LIVE) {
+        live = 0;       // секцию давно не открывали, рассылку прекращаем
+        return;
+    }
+    if (++pushcnt < EMBUI_HEAPMON_PUSH) return;
+    pushcnt = 0;
+    push();
+}
+
+/**
+ * Print со строковым экранированием JSON поверх буфера; без буфера только считает длину
+ * в SVG нет управляющих символов, экранировать нужно лишь кавычки и '\\'
+ */
+class JsonStrPrint : public Print {
+    char *dst;
+    size_t cap;
+  public:
+    size_t len = 0;
+    JsonStrPrint(char *buf = nullptr, size_t size = 0) : dst(buf), cap(size) {}
+    size_t write(uint8_t c) override {
+        if (c == '"' || c == '\\') put('\\');
+        put(c);
+        return 1;
+    }
+    void put(char c){
+        if (dst && len < cap) dst[len] = c;
+        ++len;
+    }
+};
+
+static const char P_hm_head[] PROGMEM = "{\"pkg\":\"value\",\"final\":true,\"section\":\"" HEAPMON_ID "\",\"block\":[{\"id\":\"" HEAPMON_ID "\",\"value\":\"";
+static const char P_hm_tail[] PROGMEM = "\",\"html\":true}]}";
+
+/**
+ * разослать свежий график клиентам, у которых открыта секция; у остальных элемента нет и значение игнорируется
+ * фрейм value собирается прямо в буфере сообщения по замеренной длине, без Interface и промежуточных строк;
+ * клиенты с MessagePack принимают и текстовые сообщения
+ */
+void HeapMon::push(){
+    if (!embui.ws.count()) return;
+    JsonStrPrint measure;
+    printSvg(measure);
+    const size_t hlen = strlen_P(P_hm_head), tlen = strlen_P(P_hm_tail);
+    size_t len = hlen + measure.len + tlen;
+
+    AsyncWebSocketMessageBuffer *buffer = embui.ws.makeBuffer(len);     // буфер размером len+1
+    if (!buffer) return;
+    char *p = (char*)buffer->get();
+    memcpy_P(p, P_hm_head, hlen);
+    JsonStrPrint out(p + hlen, measure.len);
+    printSvg(out);
+    memcpy_P(p + hlen + measure.len, P_hm_tail, tlen + 1);
+    embui.ws.textAll(buffer);
+    METRIC_INC(M_WS_OUT_MSGS);
+    METRIC_ADD(M_WS_OUT_BYTES, len);
+}
+
+void HeapMon::printTo(Print &out) const {
+    out.printf_P(PSTR("{\"period\":%u,\"now\":%lu,\"tags\":["), EMBUI_HEAPMON_PERIOD, (unsigned long)millis());
+    for (uint8_t b = 0; b < HEAP_TAGS; b++) {
+        if (b) out.write(',');
+        out.write('"');
+        out.print(name(b));
+        out.write('"');
+    }
+    out.print(F("],\"fields\":[\"ms\",\"free\",\"minfree\",\"block\",\"frag\",\"tags\"],\"samples\":["));
+    for (uint8_t i = 0; i < cnt; i++) {
+        const heap_sample_t &s = at(i);
+        out.printf_P(PSTR("%s[%lu,%lu,%lu,%lu,%u,%u]"), i ? "," : "", (unsigned long)s.ms, (unsigned long)s.free,
+            (unsigned long)s.minfree, (unsigned long)s.block, s.frag, s.tags);
+    }
+    out.print(F("]}"));
+}
+
+void HeapMon::printSvg(Print &out) const {
+    const uint16_t w = SVG_STEP * (EMBUI_HEAPMON_DEPTH - 1);
+    const uint16_t h = SVG_H + 4 + SVG_ROW * HEAP_TAGS + 14;
+    char color[8], label[12];
+
+    // масштаб памяти по максимуму в буфере, фрагментация - 0..100%
+    uint32_t top = 1;
+    for (uint8_t i = 0; i < cnt; i++) if (at(i).free > top) top = at(i).free;
+
+    out.printf_P(PSTR("<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 %u %u\" width=\"100%%\" font-size=\"9\">"), w, h);
+    out.printf_P(PSTR("<rect width=\"%u\" height=\"%u\" fill=\"none\" stroke=\"#ccc\"/>"), w, SVG_H);
+    out.printf_P(PSTR("<text x=\"2\" y=\"9\">%lu</text>"), (unsigned long)top);
+
+    // замеры прижаты к правому краю: новые появляются справа
+    const uint8_t x0 = EMBUI_HEAPMON_DEPTH - cnt;
+    for (uint8_t l = 0; cnt && l < 3; l++) {
+        strcpy_P(color, line_colors[l]);
+        out.printf_P(PSTR("<polyline fill=\"none\" stroke=\"%s\" points=\""), color);
+        for (uint8_t i = 0; i < cnt; i++) {
+            const heap_sample_t &s = at(i);
+            uint32_t y = l == 2 ? SVG_H - s.frag * SVG_H / 100 : SVG_H - (uint64_t)(l == 1 ? s.block : s.free) * SVG_H / top;
+            out.printf_P(PSTR("%u,%lu "), (x0 + i) * SVG_STEP, (unsigned long)y);
+        }
+        out.print(F("\"/>"));
+    }
+
+    // метка - толстая линия под замерами, подряд идущие замеры сливаются в один отрезок
+    for (uint8_t b = 0; b < HEAP_TAGS; b++) {
+        strcpy_P(color, (PGM_P)pgm_read_ptr(&heap_tag_colors[b]));
+        bool open = false;
+        for (uint8_t i = 0; i < cnt; i++) {
+            if (!(at(i).tags & (1 << b))) continue;
+            uint8_t run = 1;
+            while (i + run < cnt && (at(i + run).tags & (1 << b))) ++run;
+            if (!open) out.printf_P(PSTR("<path stroke=\"%s\" stroke-width=\"%u\" d=\""), color, SVG_ROW - 1);
+            open = true;
+            out.printf_P(PSTR("M%d %uh%u"), (int)((x0 + i) * SVG_STEP) - SVG_STEP / 2, SVG_H + 4 + b * SVG_ROW + SVG_ROW / 2, run * SVG_STEP);
+            i += run - 1;
+        }
+        if (open) out.print(F("\"/>"));
+    }
+
+    // легенда
+    uint16_t x = 2;
+    const uint16_t y = h - 3;
+    for (uint8_t l = 0; l < 3 + HEAP_TAGS; l++) {
+        if (l < 3) {
+            strcpy_P(color, line_colors[l]);
+            strcpy_P(label, line_names[l]);
+        } else {
+            strcpy_P(color, (PGM_P)pgm_read_ptr(&heap_tag_colors[l - 3]));
+            strcpy_P(label, (PGM_P)pgm_read_ptr(&heap_tag_names[l - 3]));
+        }
+        out.printf_P(PSTR("<text x=\"%u\" y=\"%u\" fill=\"%s\">%s</text>"), x, y, color, label);
+        x += 5 * strlen(label) + 6;
+    }
+    out.print(F("</svg>"));
+}
+
+void HeapMon::ui(Interface *interf){
+    live = millis() | 1;
+    pushcnt = 0;
+
+    StreamString svg;
+    printSvg(svg);
+    interf->comment(F(HEAPMON_ID), svg);
+
+    if (!cnt) return;
+    const heap_sample_t &s = at(cnt - 1);
+    char buf[48];
+    snprintf_P(buf, sizeof(buf), PSTR("%lu / %lu / %lu / %u"), (unsigned long)s.free, (unsigned long)s.minfree,
+        (unsigned long)s.block, s.frag);
+    interf->constant(F(HEAPMON_ID "_last"), buf, F("Heap free/min/block/frag%"));
+}
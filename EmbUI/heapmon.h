@@ -0,0 +1,109 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+#include "timerwheel.h"
+
+#ifndef EMBUI_HEAPMON_DEPTH
+#define EMBUI_HEAPMON_DEPTH     32      // сколько замеров хранит кольцевой буфер
+#endif
+
+#ifndef EMBUI_HEAPMON_PERIOD
+#define EMBUI_HEAPMON_PERIOD    1000    // период замера кучи, мс
+#endif
+
+#ifndef EMBUI_HEAPMON_LIVE
+#define EMBUI_HEAPMON_LIVE      300000  // сколько после открытия секции график рассылается клиентам, мс
+#endif
+
+#ifndef EMBUI_HEAPMON_PUSH
+#define EMBUI_HEAPMON_PUSH      5       // график рассылается раз в столько замеров
+#endif
+
+#define HEAPMON_ID              "heapmon"   // id элемента с графиком в UI
+
+/**
+ * подсистемы, работавшие между замерами, битовая маска
+ */
+typedef enum : uint8_t {
+    HEAP_RENDER = 1 << 0,   // построение Interface
+    HEAP_POST   = 1 << 1,   // обработчики секций
+    HEAP_SAVE   = 1 << 2,   // запись конфига
+    HEAP_MQTT   = 1 << 3,
+    HEAP_WSCONN = 1 << 4,   // подключение ws-клиента
+    HEAP_TAGS   = 5
+} heap_tag_t;
+
+class Interface;
+
+/**
+ * Фоновый монитор кучи: раз в EMBUI_HEAPMON_PERIOD снимает свободную память, наибольший блок и фрагментацию
+ * в кольцевой буфер фиксированного размера, каждый замер помечен подсистемами, работавшими с прошлого замера.
+ * Замер делается из колеса таймеров в контексте loop(), на ESP8266 это один проход umm_info(),
+ * метки ставятся одной командой и дополнительно обновляют минимум свободной памяти между замерами
+ */
+class HeapMon {
+  public:
+    typedef struct heap_sample_t {
+        uint32_t ms;            // millis() замера
+        uint32_t free;          // свободно, байт
+        uint32_t minfree;       // минимум свободной памяти на границах меток с прошлого замера
+        uint32_t block;         // наибольший блок, байт
+        uint8_t frag;           // фрагментация, %
+        uint8_t tags;           // heap_tag_t
+    } heap_sample_t;
+
+  private:
+    heap_sample_t ring[EMBUI_HEAPMON_DEPTH];
+    uint8_t head = 0;           // следующая запись
+    uint8_t cnt = 0;
+    uint8_t pushcnt = 0;
+    uint32_t seen = 0;          // метки с прошлого замера, 32 бита ради атомарных операций на ESP32
+    uint32_t low = UINT32_MAX;  // минимум свободной памяти с прошлого замера
+    uint32_t live = 0;          // millis() последнего открытия секции, 0 - не открывалась
+    TwTimer timer;
+
+    void sample();
+    void push();
+
+  public:
+    void begin();
+
+    inline void tag(uint8_t t){
+#ifdef ESP32
+        __atomic_fetch_or(&seen, t, __ATOMIC_RELAXED);
+#else
+        seen |= t;
+#endif
+    }
+    // отметить текущий уровень свободной памяти
+    void mark();
+
+    uint8_t size() const { return cnt; }
+    // i-й замер от самого старого
+    const heap_sample_t &at(uint8_t i) const { return ring[(head + EMBUI_HEAPMON_DEPTH - cnt + i) % EMBUI_HEAPMON_DEPTH]; }
+    static const __FlashStringHelper *name(uint8_t bit);
+
+    // все замеры в JSON для /heap.json
+    void printTo(Print &out) const;
+    // график в SVG: свободная память, наибольший блок и фрагментация, ниже - полосы меток
+    void printSvg(Print &out) const;
+    // блок UI с графиком, включает рассылку графика клиентам на EMBUI_HEAPMON_LIVE
+    void ui(Interface *interf);
+};
+
+extern HeapMon heapmon;
+
+class HeapTag {
+  public:
+    HeapTag(uint8_t t){ heapmon.tag(t); }
+    ~HeapTag(){ heapmon.mark(); }
+};
+
+#define HEAP_CAT2(a, b) a##b
+#define HEAP_CAT(a, b) HEAP_CAT2(a, b)
+#define HEAP_TAG(t) HeapTag HEAP_CAT(_htag_, __LINE__)(t)
@@ -0,0 +1,89 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "metrics.h"
+
+Metrics metrics;
+
+static const char P_m_counter[] PROGMEM = "counter";
+
+static const char P_m_ws_in_msgs[] PROGMEM = "embui_ws_in_messages_total";
+static const char P_m_ws_in_bytes[] PROGMEM = "embui_ws_in_bytes_total";
+static const char P_m_ws_out_msgs[] PROGMEM = "embui_ws_out_messages_total";
+static const char P_m_ws_out_bytes[] PROGMEM = "embui_ws_out_bytes_total";
+static const char P_m_ui_renders[] PROGMEM = "embui_ui_renders_total";
+static const char P_m_ui_frames[] PROGMEM = "embui_ui_frames_total";
+static const char P_m_ui_overflow[] PROGMEM = "embui_ui_frame_overflows_total";
+static const char P_m_post[] PROGMEM = "embui_post_handled_total";
+static const char P_m_mqtt_pub[] PROGMEM = "embui_mqtt_publishes_total";
+static const char P_m_mqtt_reconn[] PROGMEM = "embui_mqtt_reconnects_total";
+static const char P_m_cfg_saves[] PROGMEM = "embui_config_saves_total";
+static const char P_m_cfg_errors[] PROGMEM = "embui_config_save_errors_total";
+static const char P_m_pub_evict[] PROGMEM = "embui_pub_slot_evictions_total";
+
+static const char P_h_ws_in_msgs[] PROGMEM = "WebSocket messages received";
+static const char P_h_ws_in_bytes[] PROGMEM = "WebSocket bytes received";
+static const char P_h_ws_out_msgs[] PROGMEM = "WebSocket messages sent, broadcast counts once";
+static const char P_h_ws_out_bytes[] PROGMEM = "WebSocket bytes sent";
+static const char P_h_ui_renders[] PROGMEM = "Interface objects rendered";
+static const char P_h_ui_frames[] PROGMEM = "UI frames sent";
+static const char P_h_ui_overflow[] PROGMEM = "UI elements that did not fit into the current frame";
+static const char P_h_post[] PROGMEM = "Section handler invocations";
+static const char P_h_mqtt_pub[] PROGMEM = "MQTT publishes";
+static const char P_h_mqtt_reconn[] PROGMEM = "MQTT connection attempts";
+static const char P_h_cfg_saves[] PROGMEM = "Config writes completed";
+static const char P_h_cfg_errors[] PROGMEM = "Config writes failed";
+static const char P_h_pub_evict[] PROGMEM = "Published value slots evicted, delta table full";
+
+static const char *const metric_names[M_COUNTERS] PROGMEM = {
+    P_m_ws_in_msgs, P_m_ws_in_bytes, P_m_ws_out_msgs, P_m_ws_out_bytes, P_m_ui_renders, P_m_ui_frames,
+    P_m_ui_overflow, P_m_post, P_m_mqtt_pub, P_m_mqtt_reconn, P_m_cfg_saves, P_m_cfg_errors, P_m_pub_evict
+};
+
+static const char *const metric_help[M_COUNTERS] PROGMEM = {
+    P_h_ws_in_msgs, P_h_ws_in_bytes, P_h_ws_out_msgs, P_h_ws_out_bytes, P_h_ui_renders, P_h_ui_frames,
+    P_h_ui_overflow, P_h_post, P_h_mqtt_pub, P_h_mqtt_reconn, P_h_cfg_saves, P_h_cfg_errors, P_h_pub_evict
+};
+
+void Metrics::print(Print &out, PGM_P name, PGM_P help, PGM_P type, uint32_t value, PGM_P lname, const char *lvalue){
+    if (help) {
+        out.print(F("# HELP "));
+        out.print(FPSTR(name));
+        out.write(' ');
+        out.print(FPSTR(help));
+        out.write('\n');
+    }
+    if (type) {
+        out.print(F("# TYPE "));
+        out.print(FPSTR(name));
+        out.write(' ');
+        out.print(FPSTR(type));
+        out.write('\n');
+    }
+    out.print(FPSTR(name));
+    if (lname) {
+        out.write('{');
+        out.print(FPSTR(lname));
+        out.print(F("=\""));
+        for (const char *c = lvalue; c && *c; c++) {
+            switch (*c) {
+                case '\\': out.print(F("\\\\")); break;
+                case '"': out.print(F("\\\"")); break;
+                case '\n': out.print(F("\\n")); break;
+                default: out.write(*c);
+            }
+        }
+        out.print(F("\"}"));
+    }
+    out.write(' ');
+    out.print(value);
+    out.write('\n');
+}
+
+void Metrics::printTo(Print &out) const {
+    for (uint8_t i = 0; i < M_COUNTERS; i++) {
+        print(out, (PGM_P)pgm_read_ptr(&metric_names[i]), (PGM_P)pgm_read_ptr(&metric_help[i]), P_m_counter, v[i]);
+    }
+}
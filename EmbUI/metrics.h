@@ -0,0 +1,61 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+
+/**
+ * Счетчики фреймворка для /metrics
+ * инкремент - одна команда без блокировок: на ESP8266 обработчики async-событий не вытесняют loop(),
+ * на ESP32 используется атомарное сложение
+ */
+typedef enum : uint8_t {
+    M_WS_IN_MSGS = 0,       // принято ws-сообщений
+    M_WS_IN_BYTES,
+    M_WS_OUT_MSGS,          // отправлено ws-сообщений (рассылка всем считается одним)
+    M_WS_OUT_BYTES,
+    M_UI_RENDERS,           // построено Interface
+    M_UI_FRAMES,            // отправлено фреймов
+    M_UI_OVERFLOW,          // json_frame_add/json_frame_obj не поместились в текущий фрейм
+    M_POST_HANDLED,         // вызвано обработчиков секций
+    M_MQTT_PUB,
+    M_MQTT_RECONNECT,
+    M_CFG_SAVES,
+    M_CFG_SAVE_ERRORS,
+    M_PUB_EVICT,            // таблица публикаций заполнена, вытеснено давно не совпадавшее значение
+    M_COUNTERS
+} metric_id_t;
+
+class Metrics {
+    uint32_t v[M_COUNTERS] = {};
+
+  public:
+    inline void inc(uint8_t id, uint32_t n = 1){
+#ifdef ESP32
+        __atomic_fetch_add(&v[id], n, __ATOMIC_RELAXED);
+#else
+        v[id] += n;
+#endif
+    }
+    uint32_t get(uint8_t id) const { return v[id]; }
+
+    /**
+     * все счетчики в текстовом формате Prometheus, прямо в поток
+     */
+    void printTo(Print &out) const;
+
+    /**
+     * одна метрика: # HELP, # TYPE и значение, с меткой lname="lvalue", если lname задано
+     * help и type пишутся, только если заданы: серия с метками выводит их один раз.
+     * Значение метки (строка в RAM) пишется в поток целиком, с экранированием \, " и перевода строки
+     */
+    static void print(Print &out, PGM_P name, PGM_P help, PGM_P type, uint32_t value, PGM_P lname = nullptr, const char *lvalue = nullptr);
+};
+
+extern Metrics metrics;
+
+#define METRIC_INC(id) metrics.inc(id)
+#define METRIC_ADD(id, n) metrics.inc(id, n)
@@ -8,6 +8,8 @@ extern EmbUI embui;
 
 void EmbUI::connectToMqtt() {
   LOG(println, PSTR("UI: Connecting to MQTT..."));
+  METRIC_INC(M_MQTT_RECONNECT);
+  HEAP_TAG(HEAP_MQTT);
   mqttClient.connect();
 }
 
@@ -47,8 +49,6 @@ void EmbUI::mqtt(const String &pref, const String &host, int port, const String
     String m_port=param(FPSTR(P_m_port));
     String m_user=param(FPSTR(P_m_user));
     String m_pass=param(FPSTR(P_m_pass));
-    IPAddress ip; 
-    bool isIP = ip.fromString(m_host);
 
     if(m_pref == FPSTR(P_null)) var(FPSTR(P_m_pref), pref);
     if(m_host == FPSTR(P_null)) var(FPSTR(P_m_host), host);
@@ -67,13 +67,31 @@ void EmbUI::mqtt(const String &pref, const String &host, int port, const String
     mqttClient.onUnsubscribe(onMqttUnsubscribe);
     mqttClient.onMessage(onMqttMessage);
     mqttClient.onPublish(onMqttPublish);
-    mqttClient.setCredentials(m_user.c_str(), m_pass.c_str());
-    if(isIP)
-        mqttClient.setServer(ip, m_port.toInt());
-    else
-        mqttClient.setServer(m_host.c_str(), m_port.toInt());
-    
     sysData.mqtt_enable = true;
+    mqtt_reconf();
+}
+
+/**
+ * передать клиенту сервер и учетные данные из конфига
+ * AsyncMqttClient хранит указатели, поэтому строки копируются в члены EmbUI:
+ * значения в конфиге могут переезжать при уплотнении арены.
+ * При изменении ключей "m_*" наблюдатель вызывает эту функцию снова
+ */
+void EmbUI::mqtt_reconf(){
+    if (!sysData.mqtt_enable) return;
+
+    mqtt_host = param(FPSTR(P_m_host));
+    mqtt_user = param(FPSTR(P_m_user));
+    mqtt_pass = param(FPSTR(P_m_pass));
+    IPAddress ip;
+    mqttClient.setCredentials(mqtt_user.c_str(), mqtt_pass.c_str());
+    if (ip.fromString(mqtt_host))
+        mqttClient.setServer(ip, cfg.get<int>(FPSTR(P_m_port)));
+    else
+        mqttClient.setServer(mqtt_host.c_str(), cfg.get<int>(FPSTR(P_m_port)));
+
+    // переподключение с новыми параметрами выполнит mqtt_reconnect()
+    if (mqttClient.connected()) mqttClient.disconnect();
 }
 
 void EmbUI::mqtt(const String &pref, const String &host, int port, const String &user, const String &pass, void (*mqttFunction) (const String &topic, const String &payload)){
@@ -128,19 +146,15 @@ void EmbUI::mqtt(const String &host, int port, const String &user, const String
 }
 
 void EmbUI::mqtt_handle(){
-    String host = cfg[FPSTR(P_m_host)];
-    if (!sysData.wifi_sta || host.isEmpty()) return;
+    const char *host = cfg.get<const char*>(FPSTR(P_m_host));
+    if (!sysData.wifi_sta || !host || !*host) return;
     if (sysData.mqtt_connect) onMqttConnect();
-    mqtt_reconnect();
 }
 
 /*
- * TODO: убрать этот бардак в планировщик
+ * вызывается из планировщика раз в MQTT_RECONNECT_PERIOD
  */
 void EmbUI::mqtt_reconnect(){
-    static unsigned long tmout = 0;
-    if (tmout + 15000 > millis()) return;
-    tmout = millis();
     if ( sysData.wifi_sta && !sysData.mqtt_connected) connectToMqtt();
 }
 
@@ -155,6 +169,7 @@ void EmbUI::_onMqttConnect(bool sessionPresent) {
 }
 
 void EmbUI::onMqttConnect(){
+    HEAP_TAG(HEAP_MQTT);
     sysData.mqtt_connect = false;
     sysData.mqtt_connected = true;
     Serial.println(F("Connected to MQTT."));
@@ -164,6 +179,7 @@ void EmbUI::onMqttConnect(){
 }
 
 void EmbUI::onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties properties, size_t len, size_t index, size_t total) {
+    HEAP_TAG(HEAP_MQTT);
     LOG(print, F("Publish received: "));
     Serial.println(topic);
 
@@ -210,11 +226,15 @@ void EmbUI::subscribeAll(bool isOnlyGetSet){
 
 void EmbUI::publish(const String &topic, const String &payload, bool retained){
     if (!sysData.wifi_sta || !sysData.mqtt_enable) return;
+    METRIC_INC(M_MQTT_PUB);
+    HEAP_TAG(HEAP_MQTT);
     mqttClient.publish(id(topic).c_str(), 0, retained, payload.c_str());
 }
 
 void EmbUI::publish(const String &topic, const String &payload){
     if (!sysData.wifi_sta || !sysData.mqtt_enable) return;
+    METRIC_INC(M_MQTT_PUB);
+    HEAP_TAG(HEAP_MQTT);
     mqttClient.publish(id(topic).c_str(), 0, false, payload.c_str());
 }
 
@@ -0,0 +1,137 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "postqueue.h"
+
+// на ESP8266 асинхронные колбэки не вытесняют loop(), блокировка нужна только для двухъядерного ESP32
+void PostQueue::lock(){
+#ifdef ESP32
+    portENTER_CRITICAL(&mux);
+#endif
+}
+
+void PostQueue::unlock(){
+#ifdef ESP32
+    portEXIT_CRITICAL(&mux);
+#endif
+}
+
+/**
+ * копия пакета в куче в конец запаса
+ */
+bool PostQueue::push_spill(JsonObject data, size_t len){
+    postq_spill_t *sp = nullptr;
+    if (nspill < EMBUI_POSTQ_SPILL && len <= 0xFFFF) sp = (postq_spill_t*)malloc(sizeof(postq_spill_t) + len + 1);
+    if (sp) {
+        sp->next = nullptr;
+        sp->len = serializeJson(data, (char*)(sp + 1), len + 1);
+    }
+
+    lock();
+    if (!sp || nspill == EMBUI_POSTQ_SPILL) {
+        ++stat.overflow;
+        unlock();
+        free(sp);
+        return false;
+    }
+    *spilltail = sp;
+    spilltail = &sp->next;
+    ++nspill;
+    ++stat.spilled;
+    unlock();
+    return true;
+}
+
+bool PostQueue::push(JsonObject data){
+    size_t len = measureJson(data);
+    // за пакетами в запасе встают и короткие, иначе они бы их обогнали
+    if (len >= EMBUI_POSTQ_SLOT || nspill) return push_spill(data, len);
+
+    uint32_t key = 0;
+    if (data.size() == 1) {
+        JsonPair kv = *data.begin();
+        if (!kv.value().isNull()) key = embui_hash(kv.key().c_str()) | 1;   // null - переход по меню/кнопке
+    }
+
+    lock();
+    postq_slot_t *slot = nullptr;
+    for (uint8_t i = count; key && i-- > 0; ) {
+        postq_slot_t *s = &slots[(head + i) % EMBUI_POSTQ_DEPTH];
+        if (!s->key) break;         // не обгоняем пакеты другого вида
+        if (s->key == key) {
+            slot = s;               // новое значение замещает ожидающее
+            ++stat.merged;
+            break;
+        }
+    }
+    if (!slot) {
+        if (count == EMBUI_POSTQ_DEPTH) {
+            unlock();
+            return push_spill(data, len);
+        }
+        slot = &slots[(head + count) % EMBUI_POSTQ_DEPTH];
+        slot->key = key;
+        ++count;
+        ++stat.queued;
+        if (count > stat.depth_max) stat.depth_max = count;
+    }
+    slot->len = serializeJson(data, slot->data, EMBUI_POSTQ_SLOT);
+    unlock();
+    return true;
+}
+
+char *PostQueue::pop(char *buf, size_t size){
+    lock();
+    if (count) {
+        // в слотах всегда пакеты старше запаса: пока запас не пуст, слоты не пополняются
+        postq_slot_t *slot = &slots[head];
+        size_t len = slot->len < size ? slot->len : size - 1;
+        memcpy(buf, slot->data, len);
+        buf[len] = '\0';
+        head = (head + 1) % EMBUI_POSTQ_DEPTH;
+        --count;
+        unlock();
+        return buf;
+    }
+    postq_spill_t *sp = spill;
+    if (sp) {
+        spill = sp->next;
+        if (!spill) spilltail = &spill;
+        --nspill;
+    }
+    unlock();
+    if (!sp) return nullptr;
+
+    // данные к началу блока, чтобы вызывающий освобождал его как обычную строку
+    size_t len = sp->len;
+    memmove(sp, sp + 1, len);
+    ((char*)sp)[len] = '\0';
+    return (char*)sp;
+}
+
+void PostQueue::done(uint32_t us){
+    ++stat.processed;
+    stat.lat_sum += us;
+    if (us > stat.lat_max) stat.lat_max = us;
+}
+
+bool PostQueue::push_connect(uint32_t id){
+    lock();
+    bool ok = nconnects < POSTQ_CONNECTS;
+    if (ok) connects[nconnects++] = id;
+    unlock();
+    return ok;
+}
+
+uint32_t PostQueue::pop_connect(){
+    lock();
+    uint32_t id = 0;
+    if (nconnects) {
+        id = connects[0];
+        memmove(connects, connects + 1, --nconnects * sizeof(uint32_t));
+    }
+    unlock();
+    return id;
+}
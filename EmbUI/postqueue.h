@@ -0,0 +1,110 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+#include <ArduinoJson.h>
+
+#ifndef EMBUI_POSTQ_DEPTH
+#define EMBUI_POSTQ_DEPTH   4       // сколько post-пакетов может ждать обработки
+#endif
+
+#ifndef EMBUI_POSTQ_SLOT
+#define EMBUI_POSTQ_SLOT    256     // размер слота под сериализованный post, байт
+#endif
+
+#ifndef EMBUI_POSTQ_PERIOD
+#define EMBUI_POSTQ_PERIOD  50      // минимальный интервал между разборами очереди, мс
+#endif
+
+#ifndef EMBUI_POSTQ_BUDGET
+#define EMBUI_POSTQ_BUDGET  20      // сколько времени за один проход handle() можно потратить на обработчики, мс
+#endif
+
+#ifndef EMBUI_POSTQ_SPILL
+#define EMBUI_POSTQ_SPILL   4       // сколько пакетов, не попавших в слоты, ждет в куче; дальше пакеты отбрасываются
+#endif
+
+#define POSTQ_CONNECTS      4       // сколько новых ws-клиентов может ждать построения интерфейса
+
+/**
+ * Очередь отложенной обработки ws-пакетов
+ * обработчик ws-событий только копирует post в заранее выделенный слот (или запоминает id нового клиента),
+ * обработчики секций и построение интерфейса выполняются в EmbUI::handle().
+ * Пакеты "directly"-контролов (один ключ - одно значение) схлопываются: в очереди остается только
+ * последнее значение, если за ним еще не встал пакет другого вида.
+ * Пакет длиннее слота или пришедший при заполненной очереди копируется в кучу (запас) и ждет там же, в handle():
+ * обработчики никогда не вызываются из контекста ws. Пока запас не пуст, новые пакеты идут за ним, порядок сохраняется
+ */
+class PostQueue {
+    typedef struct postq_slot_t {
+        uint32_t key;       // хэш id контрола, 0 - пакет не схлопывается
+        uint16_t len;
+        char data[EMBUI_POSTQ_SLOT];
+    } postq_slot_t;
+
+    // пакет в куче, данные сразу за заголовком
+    typedef struct postq_spill_t {
+        postq_spill_t *next;
+        uint16_t len;
+    } postq_spill_t;
+
+  public:
+    typedef struct postq_stat_t {
+        uint32_t queued;        // поставлено в очередь
+        uint32_t merged;        // схлопнуто с ожидающим значением
+        uint32_t spilled;       // не поместилось в слоты, ждет в куче
+        uint32_t overflow;      // отброшено: запас заполнен или нет памяти
+        uint32_t processed;     // обработано из очереди
+        uint32_t lat_sum;       // суммарное время обработчиков, мкс
+        uint32_t lat_max;       // максимальное время обработчика, мкс
+        uint8_t depth_max;      // максимальная глубина очереди
+    } postq_stat_t;
+
+  private:
+    postq_slot_t slots[EMBUI_POSTQ_DEPTH];
+    uint8_t head = 0;
+    uint8_t count = 0;
+    postq_spill_t *spill = nullptr;
+    postq_spill_t **spilltail = &spill;
+    uint8_t nspill = 0;
+    uint32_t connects[POSTQ_CONNECTS];
+    uint8_t nconnects = 0;
+    postq_stat_t stat = {};
+#ifdef ESP32
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+    void lock();
+    void unlock();
+    bool push_spill(JsonObject data, size_t len);
+
+  public:
+    /**
+     * поставить пакет в очередь
+     * @return false если пакет отброшен (счетчик overflow)
+     */
+    bool push(JsonObject data);
+
+    /**
+     * забрать самый старый пакет: пакет из слота копируется в buf, пакет из запаса отдается своим блоком
+     * @return строка пакета - buf или блок из кучи, который вызывающий освобождает free(); nullptr - очередь пуста
+     */
+    char *pop(char *buf, size_t size);
+
+    /**
+     * учесть время работы обработчика пакета, мкс
+     */
+    void done(uint32_t us);
+
+    bool push_connect(uint32_t id);
+    uint32_t pop_connect();
+
+    uint8_t size() const { return count + nspill; }
+    bool pending() const { return count || nspill || nconnects; }
+    bool connecting() const { return nconnects; }
+    const postq_stat_t &stats() const { return stat; }
+};
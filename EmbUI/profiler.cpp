@@ -0,0 +1,99 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "profiler.h"
+
+#ifdef EMBUI_PROFILER
+#include "ui.h"
+
+Profiler profiler;
+
+static const char P_prof_loop[] PROGMEM = "loop";
+static const char P_prof_persist[] PROGMEM = "cfg_persist";
+static const char P_prof_mdns[] PROGMEM = "mdns";
+static const char P_prof_mqtt[] PROGMEM = "mqtt";
+static const char P_prof_udp[] PROGMEM = "udp";
+static const char P_prof_post[] PROGMEM = "post";
+static const char P_prof_obs[] PROGMEM = "observers";
+static const char P_prof_timers[] PROGMEM = "timers";
+static const char P_prof_btn[] PROGMEM = "btn";
+static const char P_prof_led[] PROGMEM = "led";
+static const char P_prof_asave[] PROGMEM = "autosave";
+static const char P_prof_cleanup[] PROGMEM = "ws_cleanup";
+static const char P_prof_pub[] PROGMEM = "send_pub";
+
+static const char *const prof_names[PROF_STAGES] PROGMEM = {
+    P_prof_loop, P_prof_persist, P_prof_mdns, P_prof_mqtt, P_prof_udp, P_prof_post, P_prof_obs,
+    P_prof_timers, P_prof_btn, P_prof_led, P_prof_asave, P_prof_cleanup, P_prof_pub
+};
+
+const __FlashStringHelper *Profiler::name(uint8_t stage){
+    return FPSTR(pgm_read_ptr(&prof_names[stage]));
+}
+
+void Profiler::add(uint8_t stage, uint32_t cycles){
+    uint32_t us = cycles / ESP.getCpuFreqMHz();
+    prof_hist_t &h = stages[stage];
+    if (!h.count || us < h.min) h.min = us;
+    if (us > h.max) h.max = us;
+    h.sum += us;
+    ++h.count;
+
+    uint8_t b = 0;
+    for (uint32_t v = us >> 1; v && b < PROF_BUCKETS - 1; v >>= 1) ++b;
+    ++h.hist[b];
+}
+
+void Profiler::reset(){
+    memset(stages, 0, sizeof(stages));
+}
+
+uint32_t Profiler::avg(uint8_t stage) const {
+    return stages[stage].count ? stages[stage].sum / stages[stage].count : 0;
+}
+
+uint32_t Profiler::percentile(uint8_t stage, uint8_t pct) const {
+    const prof_hist_t &h = stages[stage];
+    if (!h.count) return 0;
+    uint32_t need = ((uint64_t)h.count * pct + 99) / 100;
+    uint32_t acc = 0;
+    for (uint8_t b = 0; b < PROF_BUCKETS; b++) {
+        acc += h.hist[b];
+        if (acc < need) continue;
+        uint32_t top = (2UL << b) - 1;
+        return top < h.max ? top : h.max;
+    }
+    return h.max;
+}
+
+void Profiler::printTo(Print &out) const {
+    out.print(F("stage count min avg p99 max, us\n"));
+    for (uint8_t i = 0; i < PROF_STAGES; i++) {
+        const prof_hist_t &h = stages[i];
+        out.printf_P(PSTR("%-11s %lu %lu %lu %lu %lu\n"), String(name(i)).c_str(), (unsigned long)h.count,
+            (unsigned long)h.min, (unsigned long)avg(i), (unsigned long)percentile(i, 99), (unsigned long)h.max);
+    }
+    out.print(F("\nhistogram <2us..>=32ms\n"));
+    for (uint8_t i = 0; i < PROF_STAGES; i++) {
+        out.print(name(i));
+        out.print(':');
+        for (uint8_t b = 0; b < PROF_BUCKETS; b++) {
+            out.print(' ');
+            out.print(stages[i].hist[b]);
+        }
+        out.print('\n');
+    }
+}
+
+void Profiler::ui(Interface *interf) const {
+    char buf[48];
+    for (uint8_t i = 0; i < PROF_STAGES; i++) {
+        const prof_hist_t &h = stages[i];
+        snprintf_P(buf, sizeof(buf), PSTR("%lu / %lu / %lu / %lu"), (unsigned long)h.min, (unsigned long)avg(i),
+            (unsigned long)percentile(i, 99), (unsigned long)h.max);
+        interf->constant(String(F("prof_")) + i, buf, String(name(i)) + F(", us min/avg/p99/max"));
+    }
+}
+#endif
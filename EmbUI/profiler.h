@@ -0,0 +1,90 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+
+/**
+ * Профилировщик этапов EmbUI::handle(), включается -DEMBUI_PROFILER
+ * время этапа меряется счетчиком тактов CPU и раскладывается в гистограмму по степеням двойки микросекунд,
+ * без флага макросы PROF()/PROF_CALL() пустые и код профилировщика не собирается
+ */
+#ifdef EMBUI_PROFILER
+
+#define PROF_BUCKETS        16      // <2 мкс, <4 мкс, ... >=32 мс
+
+typedef enum : uint8_t {
+    PROF_LOOP = 0,      // handle() целиком
+    PROF_PERSIST,       // фоновая запись конфига
+    PROF_MDNS,
+    PROF_MQTT,
+    PROF_UDP,
+    PROF_POST,          // очередь post-пакетов
+    PROF_OBSERVERS,     // наблюдатели конфига
+    PROF_TIMERS,        // колесо таймеров, включая этапы ниже
+    PROF_BTN,
+    PROF_LED,
+    PROF_AUTOSAVE,
+    PROF_CLEANUP,       // ws.cleanupClients()
+    PROF_PUB,           // send_pub()
+    PROF_STAGES
+} prof_stage_t;
+
+class Interface;
+
+class Profiler {
+  public:
+    typedef struct prof_hist_t {
+        uint32_t count;
+        uint32_t min;           // мкс
+        uint32_t max;
+        uint64_t sum;
+        uint32_t hist[PROF_BUCKETS];
+    } prof_hist_t;
+
+  private:
+    prof_hist_t stages[PROF_STAGES];
+
+  public:
+    Profiler(){ reset(); }
+
+    void add(uint8_t stage, uint32_t cycles);
+    void reset();
+
+    const prof_hist_t &stat(uint8_t stage) const { return stages[stage]; }
+    uint32_t avg(uint8_t stage) const;
+    // верхняя граница корзины, в которую попадает pct% замеров, не больше max
+    uint32_t percentile(uint8_t stage, uint8_t pct) const;
+    static const __FlashStringHelper *name(uint8_t stage);
+
+    // таблица "stage count min avg p99 max" для /prof
+    void printTo(Print &out) const;
+    // блок UI со статистикой этапов
+    void ui(Interface *interf) const;
+};
+
+extern Profiler profiler;
+
+class ProfScope {
+    uint8_t stage;
+    uint32_t start;
+
+  public:
+    ProfScope(uint8_t s) : stage(s), start(ESP.getCycleCount()) {}
+    ~ProfScope(){ profiler.add(stage, ESP.getCycleCount() - start); }
+};
+
+#define PROF_CAT2(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT2(a, b)
+#define PROF(stage) ProfScope PROF_CAT(_prof_, __LINE__)(stage)
+#define PROF_CALL(stage, call) do { ProfScope _prof(stage); call; } while (0)
+
+#else
+
+#define PROF(stage)
+#define PROF_CALL(stage, call) call
+
+#endif
@@ -0,0 +1,159 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+
+/**
+ * Индекс обработчиков секций для EmbUI::post
+ * точные имена лежат в хэш-таблице с открытой адресацией, имена с '*' - в префиксном дереве,
+ * поиск: сначала точное совпадение, затем самый длинный подходящий префикс
+ * T - указатель на структуру с полем String name, индекс объектами не владеет
+ */
+template <typename T>
+class SectionIndex {
+    typedef struct trie_node_t {
+        char c;
+        int16_t child;      // первый потомок
+        int16_t next;       // следующий узел того же уровня
+        T val;
+    } trie_node_t;
+
+    uint32_t *hashes = nullptr;     // 0 - свободная ячейка
+    T *vals = nullptr;
+    uint16_t cap = 0;
+    uint16_t count = 0;
+
+    trie_node_t *trie = nullptr;
+    uint16_t nodes = 0;
+    uint16_t trie_cap = 0;
+
+    static uint32_t hash(const char *key){ return embui_hash(key) | 1; }
+    void put(uint32_t h, T val);
+    void grow();
+    int16_t child(int16_t parent, char c, bool create);
+
+  public:
+    SectionIndex(){}
+    ~SectionIndex(){ clear(); }
+
+    void add(T val);
+    T find(const char *key);
+    void clear();
+    uint16_t size() const { return count; }
+};
+
+template <typename T>
+void SectionIndex<T>::put(uint32_t h, T val){
+    uint16_t i = h & (cap - 1);
+    while (hashes[i]) {
+        if (hashes[i] == h && vals[i]->name == val->name) return;   // первый зарегистрированный имеет приоритет
+        i = (i + 1) & (cap - 1);
+    }
+    hashes[i] = h;
+    vals[i] = val;
+    ++count;
+}
+
+template <typename T>
+void SectionIndex<T>::grow(){
+    uint32_t *oh = hashes;
+    T *ov = vals;
+    uint16_t ocap = cap;
+
+    cap = cap ? cap * 2 : 16;
+    hashes = new uint32_t[cap]();
+    vals = new T[cap]();
+    count = 0;
+    for (uint16_t i = 0; i < ocap; i++) {
+        if (oh[i]) put(oh[i], ov[i]);
+    }
+    delete[] oh;
+    delete[] ov;
+}
+
+template <typename T>
+int16_t SectionIndex<T>::child(int16_t parent, char c, bool create){
+    int16_t n = trie[parent].child;
+    for (; n >= 0; n = trie[n].next) {
+        if (trie[n].c == c) return n;
+    }
+    if (!create) return -1;
+
+    if (nodes == trie_cap) {
+        trie_node_t *old = trie;
+        trie_cap *= 2;
+        trie = new trie_node_t[trie_cap];
+        memcpy(trie, old, nodes * sizeof(trie_node_t));
+        delete[] old;
+    }
+    n = nodes++;
+    trie[n].c = c;
+    trie[n].child = -1;
+    trie[n].next = trie[parent].child;
+    trie[n].val = nullptr;
+    trie[parent].child = n;
+    return n;
+}
+
+template <typename T>
+void SectionIndex<T>::add(T val){
+    const char *name = val->name.c_str();
+    const char *mall = strchr(name, '*');
+
+    if (!mall) {
+        if ((count + 1) * 4 > cap * 3) grow();
+        put(hash(name), val);
+        return;
+    }
+
+    if (!trie) {
+        trie_cap = 16;
+        trie = new trie_node_t[trie_cap];
+        trie[0].c = 0;
+        trie[0].child = trie[0].next = -1;
+        trie[0].val = nullptr;
+        nodes = 1;
+    }
+
+    // как и прежний линейный разбор, символ перед '*' в сравнении не участвует: "eff_*" == префикс "eff"
+    int16_t n = 0;
+    for (const char *c = name; c < mall - 1; c++) {
+        n = child(n, *c, true);
+    }
+    if (!trie[n].val) trie[n].val = val;
+}
+
+template <typename T>
+T SectionIndex<T>::find(const char *key){
+    if (cap) {
+        uint32_t h = hash(key);
+        for (uint16_t i = h & (cap - 1); hashes[i]; i = (i + 1) & (cap - 1)) {
+            if (hashes[i] == h && vals[i]->name == key) return vals[i];
+        }
+    }
+
+    if (!trie) return nullptr;
+    T best = trie[0].val;
+    int16_t n = 0;
+    for (const char *c = key; *c; c++) {
+        n = child(n, *c, false);
+        if (n < 0) break;
+        if (trie[n].val) best = trie[n].val;
+    }
+    return best;
+}
+
+template <typename T>
+void SectionIndex<T>::clear(){
+    delete[] hashes;
+    delete[] vals;
+    delete[] trie;
+    hashes = nullptr;
+    vals = nullptr;
+    trie = nullptr;
+    cap = count = nodes = trie_cap = 0;
+}
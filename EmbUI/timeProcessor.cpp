@@ -207,7 +207,7 @@ void TimeProcessor::httprefreshtimer(const uint32_t delay){
         LOG(printf_P, PSTR("Schedule TZ refresh in %d\n"), timer);
     }
 
-    _wrk.once_scheduled(timer, std::bind(&TimeProcessor::getTimeHTTP, this));
+    _wrk.once(timer * 1000UL, std::bind(&TimeProcessor::getTimeHTTP, this));
 }
 #endif
 
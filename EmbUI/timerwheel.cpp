@@ -0,0 +1,194 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "timerwheel.h"
+
+TimerWheel timerwheel;
+
+void TwTimer::once(uint32_t ms, twCallback callback){
+    timerwheel.add(this, ms, 0, callback);
+}
+
+void TwTimer::every(uint32_t ms, twCallback callback){
+    timerwheel.add(this, ms, ms, callback);
+}
+
+void TwTimer::detach(){
+    timerwheel.lock();
+    timerwheel.unlink(this);
+    timerwheel.unlock();
+}
+
+TimerWheel::TimerWheel(){
+    for (uint8_t l = 0; l < TW_LEVELS; l++) {
+        for (uint8_t i = 0; i < TW_SLOTS; i++) wheel[l][i].next = wheel[l][i].prev = &wheel[l][i];
+    }
+}
+
+// на ESP8266 события WiFi не вытесняют loop(), блокировка нужна только для двухъядерного ESP32
+void TimerWheel::lock(){
+#ifdef ESP32
+    portENTER_CRITICAL(&mux);
+#endif
+}
+
+void TimerWheel::unlock(){
+#ifdef ESP32
+    portEXIT_CRITICAL(&mux);
+#endif
+}
+
+/**
+ * положить таймер в слот по оставшемуся числу шагов
+ */
+void TimerWheel::link(TwTimer *t){
+    uint32_t delta = t->expires - jiffies;
+    TwTimer *head;
+    if ((int32_t)delta < 0) {
+        head = &wheel[0][jiffies & TW_MASK];      // уже просрочен: на текущем шаге
+    } else if (delta < TW_SLOTS) {
+        head = &wheel[0][t->expires & TW_MASK];
+    } else if (delta < (1UL << (2 * TW_BITS))) {
+        head = &wheel[1][(t->expires >> TW_BITS) & TW_MASK];
+    } else {
+        // дальше диапазона колеса: в последний слот верхнего уровня, при раскладке он перекладывается снова
+        uint32_t e = delta < (1UL << (3 * TW_BITS)) ? t->expires : jiffies + (1UL << (3 * TW_BITS)) - 1;
+        head = &wheel[2][(e >> (2 * TW_BITS)) & TW_MASK];
+    }
+    t->next = head;
+    t->prev = head->prev;
+    head->prev->next = t;
+    head->prev = t;
+    ++count;
+}
+
+void TimerWheel::unlink(TwTimer *t){
+    if (!t->next) return;
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = nullptr;
+    --count;
+}
+
+void TimerWheel::add(TwTimer *t, uint32_t ms, uint32_t period, twCallback &callback){
+    uint32_t now = millis();
+    if (!started) {
+        last = now;
+        started = true;
+    }
+    lock();
+    unlink(t);
+    t->cb = std::move(callback);
+    // шаг jiffies + k разбирается не раньше last + (k + 1) * EMBUI_TW_TICK, а last отстает от now на время с прошлого шага:
+    // срок считается от now и округляется вверх, так что таймер не срабатывает раньше времени
+    uint32_t n = (now - last + ms + EMBUI_TW_TICK - 1) / EMBUI_TW_TICK;
+    t->expires = jiffies + (n ? n - 1 : 0);
+    t->period = period ? (period + EMBUI_TW_TICK - 1) / EMBUI_TW_TICK : 0;
+    link(t);
+    unlock();
+}
+
+/**
+ * разложить слот верхнего уровня по нижним
+ */
+void TimerWheel::cascade(uint8_t level, uint8_t slot){
+    // слот переносится во временный список: дальний таймер может вернуться в тот же слот
+    TwTimer tmp;
+    if (!splice(&wheel[level][slot], &tmp)) return;
+    while (tmp.next != &tmp) {
+        TwTimer *t = tmp.next;
+        unlink(t);
+        link(t);
+    }
+    tmp.next = nullptr;     // деструктор tmp не должен ничего снимать
+}
+
+/**
+ * перенести список слота head в пустой список to
+ */
+bool TimerWheel::splice(TwTimer *head, TwTimer *to){
+    if (head->next == head) return false;
+    to->next = head->next;
+    to->prev = head->prev;
+    to->next->prev = to->prev->next = to;
+    head->next = head->prev = head;
+    return true;
+}
+
+void TimerWheel::run(){
+    if (!started) {
+        last = millis();
+        started = true;
+        return;
+    }
+
+    uint32_t ticks = (millis() - last) / EMBUI_TW_TICK;
+    last += ticks * EMBUI_TW_TICK;
+    uint32_t target = jiffies + ticks;
+
+    while (ticks--) {
+        lock();
+        uint8_t i = jiffies & TW_MASK;
+        if (!i) {
+            uint8_t j = (jiffies >> TW_BITS) & TW_MASK;
+            if (!j) cascade(2, (jiffies >> (2 * TW_BITS)) & TW_MASK);
+            cascade(1, j);
+        }
+
+        // шаг закрывается до вызова колбэков: таймер, заведенный из колбэка, попадает не раньше следующего
+        TwTimer due;
+        bool any = splice(&wheel[0][i], &due);
+        ++jiffies;
+        while (any && due.next != &due) {
+            TwTimer *t = due.next;
+            unlink(t);
+            // периодический ставится заново до вызова: колбэк может его снять или перезапустить
+            if (t->period) {
+                t->expires += t->period;
+                // loop() долго стоял: пропущенные периоды не догоняем
+                if ((int32_t)(t->expires - target) < 0) t->expires = target + t->period - 1;
+                link(t);
+            }
+            twCallback cb = t->cb;      // однократный колбэк может заново запустить свой таймер
+            unlock();
+            if (cb) cb();
+            lock();
+        }
+        due.next = nullptr;
+        unlock();
+    }
+}
+
+uint32_t TimerWheel::next() const {
+    if (!count) return TW_NONE;
+
+    // шаг jiffies + k разбирается через rest + k * EMBUI_TW_TICK мс
+    uint32_t passed = millis() - last;
+    uint32_t rest = passed < EMBUI_TW_TICK ? EMBUI_TW_TICK - passed : 0;
+    uint32_t steps = UINT32_MAX;
+    for (uint8_t k = 0; k < TW_SLOTS; k++) {
+        const TwTimer *head = &wheel[0][(jiffies + k) & TW_MASK];
+        if (head->next != head) {
+            steps = k;
+            break;
+        }
+    }
+
+    // верхние уровни: шаг раскладки ближайшего непустого слота, таймеры из него раньше не сработают
+    for (uint8_t l = 1; l < TW_LEVELS; l++) {
+        uint8_t shift = l * TW_BITS;
+        uint32_t cur = jiffies >> shift;
+        // на границе слота текущий слот уровня еще не разложен: он раскладывается на ближайшем шаге
+        uint8_t k0 = (jiffies & ((1UL << shift) - 1)) ? 1 : 0;
+        for (uint8_t k = k0; k < k0 + TW_SLOTS; k++) {
+            const TwTimer *head = &wheel[l][(cur + k) & TW_MASK];
+            if (head->next == head) continue;
+            uint32_t s = ((cur + k) << shift) - jiffies;
+            if (s < steps) steps = s;
+            break;
+        }
+    }
+    return steps == UINT32_MAX ? TW_NONE : rest + steps * EMBUI_TW_TICK;
+}
@@ -0,0 +1,95 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+#include <functional>
+
+#ifndef EMBUI_TW_TICK
+#define EMBUI_TW_TICK       10      // шаг колеса таймеров, мс
+#endif
+
+#define TW_BITS             6
+#define TW_SLOTS            (1 << TW_BITS)      // слотов на уровень
+#define TW_MASK             (TW_SLOTS - 1)
+#define TW_LEVELS           3                   // 64 * 64 * 64 шагов по 10 мс - примерно 43 минуты, дальше таймер перекладывается
+#define TW_NONE             UINT32_MAX          // next(): таймеров нет
+
+typedef std::function<void(void)> twCallback;
+
+class TimerWheel;
+
+/**
+ * Таймер колеса, по интерфейсу похож на Ticker::once_scheduled()
+ * колбэк выполняется из EmbUI::handle(), то есть в контексте loop()
+ * объект таймера принадлежит владельцу (член класса), колесо хранит на него только ссылки
+ */
+class TwTimer {
+    friend class TimerWheel;
+
+    TwTimer *next = nullptr;    // nullptr - таймер не запущен
+    TwTimer *prev = nullptr;
+    uint32_t expires = 0;       // шаг колеса, на котором сработать
+    uint32_t period = 0;        // шагов, 0 - однократный
+    twCallback cb;
+
+    TwTimer(const TwTimer&);            // noncopyable
+    TwTimer& operator=(const TwTimer&); // noncopyable
+
+  public:
+    TwTimer(){}
+    ~TwTimer(){ detach(); }
+
+    void once(uint32_t ms, twCallback callback);
+    void every(uint32_t ms, twCallback callback);
+    void detach();
+    bool active() const { return next; }
+};
+
+/**
+ * Иерархическое колесо таймеров
+ * постановка и снятие таймера - O(1), на каждом шаге разбирается один слот нижнего уровня,
+ * раз в 64 шага таймеры следующего уровня раскладываются по нижнему.
+ * Время считается разностями millis(), поэтому переполнение millis() через 49 суток ничего не ломает
+ */
+class TimerWheel {
+    friend class TwTimer;
+
+    TwTimer wheel[TW_LEVELS][TW_SLOTS];     // голова кольцевого списка каждого слота
+    uint32_t jiffies = 0;       // текущий шаг
+    uint32_t last = 0;          // millis() текущего шага
+    bool started = false;
+    uint16_t count = 0;
+#ifdef ESP32
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+    void lock();
+    void unlock();
+    void link(TwTimer *t);
+    void unlink(TwTimer *t);
+    void cascade(uint8_t level, uint8_t slot);
+    static bool splice(TwTimer *head, TwTimer *to);
+    void add(TwTimer *t, uint32_t ms, uint32_t period, twCallback &callback);
+
+  public:
+    TimerWheel();
+
+    /**
+     * выполнить все наступившие таймеры, вызывается из EmbUI::handle()
+     */
+    void run();
+
+    /**
+     * через сколько мс сработает ближайший таймер (оценка снизу с точностью до шага), TW_NONE - таймеров нет
+     * позволяет loop() спать до следующего события
+     */
+    uint32_t next() const;
+
+    uint16_t size() const { return count; }
+};
+
+extern TimerWheel timerwheel;
@@ -5,15 +5,17 @@
 
 #include "ui.h"
 
+// оценка памяти под элемент в документе фрейма:
+// объект из members пар, копии ключей/коротких значений из PROGMEM и переданные строки
+#define UI_OBJ_SIZE(members, strlen) (JSON_OBJECT_SIZE(members) + 96 + (strlen))
+
 void Interface::hidden(const String &id, const String &value){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(3, id.length() + value.length()));
     obj[FPSTR(P_html)] = FPSTR(P_hidden);
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        hidden(id, value);
-    }
+    if (!json_frame_done()) hidden(id, value);
 }
 
 void Interface::hidden(const String &id){
@@ -21,15 +23,13 @@ void Interface::hidden(const String &id){
 }
 
 void Interface::constant(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(4, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = F("const");
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        constant(id, value, label);
-    }
+    if (!json_frame_done()) constant(id, value, label);
 }
 
 void Interface::constant(const String &id, const String &label){
@@ -37,7 +37,7 @@ void Interface::constant(const String &id, const String &label){
 }
 
 void Interface::text(const String &id, const String &value, const String &label, bool directly){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(6, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = F("text");
     obj[FPSTR(P_id)] = id;
@@ -46,9 +46,7 @@ void Interface::text(const String &id, const String &value, const String &label,
 
     if (directly) obj[FPSTR(P_directly)] = true;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        text(id, value, label, directly);
-    }
+    if (!json_frame_done()) text(id, value, label, directly);
 }
 
 void Interface::text(const String &id, const String &label, bool directly){
@@ -56,7 +54,7 @@ void Interface::text(const String &id, const String &label, bool directly){
 }
 
 void Interface::number(const String &id, int value, const String &label, int min, int max){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(7, id.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = FPSTR(P_number);
     obj[FPSTR(P_id)] = id;
@@ -65,17 +63,15 @@ void Interface::number(const String &id, int value, const String &label, int min
     obj[FPSTR(P_min)] = min;
     if (max) obj[FPSTR(P_max)] = max;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        number(id, value, label, min, max);
-    }
+    if (!json_frame_done()) number(id, value, label, min, max);
 }
 
 void Interface::number(const String &id, const String &label, int min, int max){
-    number(id, (int)embui->param(id).toInt(), label, min, max);
+    number(id, embui->param<int>(id), label, min, max);
 }
 
 void Interface::number(const String &id, float value, const String &label, float step, int min, int max){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(8, id.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = FPSTR(P_number);
     obj[FPSTR(P_id)] = id;
@@ -85,26 +81,22 @@ void Interface::number(const String &id, float value, const String &label, float
     if (max) obj[FPSTR(P_max)] = max;
     if (step) obj[FPSTR(P_step)] = step;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        number(id, value, label, step, min, max);
-    }
+    if (!json_frame_done()) number(id, value, label, step, min, max);
 }
 
 void Interface::number(const String &id, const String &label, float step, int min, int max){
-    number(id, embui->param(id).toFloat(), label, step);
+    number(id, embui->param<float>(id), label, step);
 }
 
 void Interface::time(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = FPSTR(P_time);
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        time(id, value, label);
-    }
+    if (!json_frame_done()) time(id, value, label);
 }
 
 void Interface::time(const String &id, const String &label){
@@ -112,16 +104,14 @@ void Interface::time(const String &id, const String &label){
 }
 
 void Interface::date(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = FPSTR(P_date);
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        date(id, value, label);
-    }
+    if (!json_frame_done()) date(id, value, label);
 }
 
 void Interface::date(const String &id, const String &label){
@@ -129,16 +119,14 @@ void Interface::date(const String &id, const String &label){
 }
 
 void Interface::datetime(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = F("datetime-local");
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        datetime(id, value, label);
-    }
+    if (!json_frame_done()) datetime(id, value, label);
 }
 
 void Interface::datetime(const String &id, const String &label){
@@ -146,7 +134,7 @@ void Interface::datetime(const String &id, const String &label){
 }
 
 void Interface::range(const String &id, int value, int min, int max, float step, const String &label, bool directly){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(9, id.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = F("range");
     obj[FPSTR(P_id)] = id;
@@ -158,26 +146,22 @@ void Interface::range(const String &id, int value, int min, int max, float step,
     obj[FPSTR(P_max)] = max;
     obj[FPSTR(P_step)] = step;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        range(id, value, min, max, step, label, directly);
-    }
+    if (!json_frame_done()) range(id, value, min, max, step, label, directly);
 }
 
 void Interface::range(const String &id, int min, int max, float step, const String &label, bool directly){
-    range(id, (int)embui->param(id).toInt(), min, max, step, label, directly);
+    range(id, embui->param<int>(id), min, max, step, label, directly);
 }
 
 void Interface::email(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = F("email");
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        email(id, value, label);
-    }
+    if (!json_frame_done()) email(id, value, label);
 }
 
 void Interface::email(const String &id, const String &label){
@@ -185,16 +169,14 @@ void Interface::email(const String &id, const String &label){
 }
 
 void Interface::password(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = FPSTR(P_password);
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        password(id, value, label);
-    }
+    if (!json_frame_done()) password(id, value, label);
 }
 
 void Interface::password(const String &id, const String &label){
@@ -202,29 +184,28 @@ void Interface::password(const String &id, const String &label){
 }
 
 void Interface::option(const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(2, value.length() + label.length()));
     obj[FPSTR(P_label)] = label;
     obj[FPSTR(P_value)] = value;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        option(value, label);
-    }
+    if (!json_frame_done()) option(value, label);
 }
 
 void Interface::select(const String &id, const String &value, const String &label, bool directly, bool skiplabel){
-    StaticJsonDocument<256> obj;
+    // 5 полей и секция опций: section, block
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(7, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = F("select");
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = skiplabel ? "" : label;
     if (directly) obj[FPSTR(P_directly)] = true;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        select(id, value, label, directly);
+    if (!json_frame_done()) {
+        select(id, value, label, directly, skiplabel);
         return;
     }
     section_stack.end()->idx--;
-    json_section_begin(FPSTR(P_options), "", false, false, false, section_stack.end()->block.getElement(section_stack.end()->idx));
+    json_section_begin(FPSTR(P_options), "", false, false, false, obj);
 }
 
 void Interface::select(const String &id, const String &label, bool directly, bool skiplabel){
@@ -232,7 +213,7 @@ void Interface::select(const String &id, const String &label, bool directly, boo
 }
 
 void Interface::checkbox(const String &id, const String &value, const String &label, bool directly){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(6, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = F("checkbox");
     obj[FPSTR(P_id)] = id;
@@ -240,9 +221,7 @@ void Interface::checkbox(const String &id, const String &value, const String &la
     obj[FPSTR(P_label)] = label;
     if (directly) obj[FPSTR(P_directly)] = true;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        checkbox(id, value, label, directly);
-    }
+    if (!json_frame_done()) checkbox(id, value, label, directly);
 }
 
 void Interface::checkbox(const String &id, const String &label, bool directly){
@@ -250,16 +229,14 @@ void Interface::checkbox(const String &id, const String &label, bool directly){
 }
 
 void Interface::color(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_input);
     obj[FPSTR(P_type)] = FPSTR(P_color);
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        color(id, value, label);
-    }
+    if (!json_frame_done()) color(id, value, label);
 }
 
 void Interface::color(const String &id, const String &label){
@@ -267,84 +244,79 @@ void Interface::color(const String &id, const String &label){
 }
 
 void Interface::file(const String &name, const String &action, const String &label){
-     StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(4, name.length() + action.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_file);
     obj[F("name")] = name;
     obj[F("action")] = action;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        file(name, action, label);
-    }
+    if (!json_frame_done()) file(name, action, label);
 }
 
 void Interface::button(const String &id, const String &label, const String &color){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(4, id.length() + color.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_button);
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_color)] = color;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        button(id, label, color);
-    }
+    if (!json_frame_done()) button(id, label, color);
 }
 
 void Interface::button_submit(const String &section, const String &label, const String &color){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(4, section.length() + color.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_button);
     obj[FPSTR(P_submit)] = section;
     obj[FPSTR(P_color)] = color;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        button_submit(section, label, color);
-    }
+    if (!json_frame_done()) button_submit(section, label, color);
 }
 
 void Interface::button_submit_value(const String &section, const String &value, const String &label, const String &color){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(5, section.length() + value.length() + color.length() + label.length()));
     obj[FPSTR(P_html)] = FPSTR(P_button);
     obj[FPSTR(P_submit)] = section;
     obj[FPSTR(P_color)] = color;
     obj[FPSTR(P_label)] = label;
     obj[FPSTR(P_value)] = value;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        button_submit_value(section, value, label, color);
-    }
+    if (!json_frame_done()) button_submit_value(section, value, label, color);
 }
 
 void Interface::spacer(const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(2, label.length()));
     obj[FPSTR(P_html)] = F("spacer");
     if (label != "") obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        spacer(label);
-    }
+    if (!json_frame_done()) spacer(label);
 }
 
 void Interface::comment(const String &label){
-    StaticJsonDocument<512> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(2, label.length()));
     obj[FPSTR(P_html)] = F("comment");
     if (label != "") obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        comment(label);
-    }
+    if (!json_frame_done()) comment(label);
+}
+
+void Interface::comment(const String &id, const String &label){
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(3, id.length() + label.length()));
+    obj[FPSTR(P_html)] = F("comment");
+    obj[FPSTR(P_id)] = id;
+    obj[FPSTR(P_label)] = label;
+
+    if (!json_frame_done()) comment(id, label);
 }
 
 void Interface::textarea(const String &id, const String &value, const String &label){
-    StaticJsonDocument<256> obj;
+    JsonObject obj = json_frame_obj(UI_OBJ_SIZE(4, id.length() + value.length() + label.length()));
     obj[FPSTR(P_html)] = F("textarea");
     obj[FPSTR(P_id)] = id;
     obj[FPSTR(P_value)] = value;
     obj[FPSTR(P_label)] = label;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        textarea(id, label);
-    }
+    if (!json_frame_done()) textarea(id, value, label);
 }
 
 void Interface::textarea(const String &id, const String &label){
@@ -352,14 +324,15 @@ void Interface::textarea(const String &id, const String &label){
 }
 
 void Interface::value(const String &id, const String &val, bool html){
-    StaticJsonDocument<256> obj;
-    obj[FPSTR(P_id)] = id;
-    obj[FPSTR(P_value)] = val;
-    if (html) obj[FPSTR(P_html)] = true;
+    if (broadcast && !embui->pub_changed(id, val, html, delta) && delta) return;
 
-    if (!json_frame_add(obj.as<JsonObject>())) {
-        value(id, val, html);
-    }
+    // повтор в новом фрейме без value(): значение уже учтено в таблице публикаций
+    do {
+        JsonObject obj = json_frame_obj(UI_OBJ_SIZE(3, id.length() + val.length()));
+        obj[FPSTR(P_id)] = id;
+        obj[FPSTR(P_value)] = val;
+        if (html) obj[FPSTR(P_html)] = true;
+    } while (!json_frame_done());
 }
 
 void Interface::value(const String &id, bool html){
@@ -386,6 +359,45 @@ void Interface::json_frame_interface(const String &name){
     json_section_begin("root" + String(rand()));
 }
 
+/**
+ * резервирует новый элемент в текущем блоке секции, поля элемента пишутся прямо во фрейм
+ * если оценки памяти под элемент не хватает, текущий фрейм предварительно отправляется
+ * @param size - оценка памяти под элемент (с учетом копий строк)
+ */
+JsonObject Interface::json_frame_obj(size_t size) {
+    LOG(printf_P, PSTR("json_frame_obj: %u = %u "), size, json.capacity() - json.memoryUsage());
+    if (json.capacity() - json.memoryUsage() < size + 40) {
+        LOG(printf_P, PSTR("UI: BAD MEM: %u\n"), ESP.getFreeHeap());
+        METRIC_INC(M_UI_OVERFLOW);
+        json_frame_send();
+        json_frame_next();
+    }
+    section_stack.end()->idx++;
+    LOG(printf_P, PSTR("UI: OK [%u]\tMEM: %u\n"), section_stack.end()->idx, ESP.getFreeHeap());
+    // в новом фрейме повторять элемент бессмысленно, если он и так первым идет после json_frame_next()
+    objretry = json.memoryUsage() > framebase;
+    return section_stack.end()->block.createNestedObject();
+}
+
+/**
+ * проверка элемента, заполненного после json_frame_obj(): поле, не поместившееся в документ, пропадает молча,
+ * поэтому недописанный элемент убирается, фрейм отправляется без него, а элемент надо повторить в новом фрейме
+ * @return true - элемент записан целиком (или повтор не поможет)
+ */
+bool Interface::json_frame_done(){
+    if (!json.overflowed()) return true;
+    LOG(printf_P, PSTR("UI: element overflowed the frame: %u\n"), json.capacity());
+    METRIC_INC(M_UI_OVERFLOW);
+    if (!objretry) return true;
+
+    JsonArray block = section_stack.end()->block;
+    block.remove(block.size() - 1);
+    section_stack.end()->idx--;
+    json_frame_send();
+    json_frame_next();
+    return false;
+}
+
 bool Interface::json_frame_add(JsonObject obj) {
     LOG(printf_P, PSTR("json_frame_add: %u = %u "), obj.memoryUsage(), json.capacity() - json.memoryUsage());
     if (json.capacity() - json.memoryUsage() > obj.memoryUsage() + 40 && section_stack.end()->block.add(obj)) {
@@ -394,6 +406,7 @@ bool Interface::json_frame_add(JsonObject obj) {
         return true;
     }
     LOG(printf_P, PSTR("UI: BAD MEM: %u\n"), ESP.getFreeHeap());
+    METRIC_INC(M_UI_OVERFLOW);
 
     json_frame_send();
     json_frame_next();
@@ -410,6 +423,7 @@ void Interface::json_frame_next(){
         LOG(printf_P, PSTR("UI: section %u %s %u\n"), i, section_stack[i]->name.c_str(), section_stack[i]->idx);
         section_stack[i]->block = obj.createNestedArray(FPSTR(P_block));
     }
+    framebase = json.memoryUsage();
     LOG(printf_P, PSTR("json_frame_next: [%u] %u = %u\n"), section_stack.size(), obj.memoryUsage(), json.capacity() - json.memoryUsage());
 }
 
@@ -419,10 +433,16 @@ void Interface::json_frame_clear(){
         delete section;
     }
     json.clear();
+    framebase = 0;
 }
 
 void Interface::json_frame_flush(){
     if (!section_stack.size()) return;
+    if (delta && section_stack.size() == 1 && !section_stack[0]->idx) {
+        LOG(println, F("json_frame_flush: no changes"));
+        json_frame_clear();
+        return;
+    }
     LOG(println, F("json_frame_flush"));
     json[FPSTR(P_final)] = true;
     json_section_end();
@@ -431,10 +451,12 @@ void Interface::json_frame_flush(){
 }
 
 void Interface::json_frame_send(){
-    String buff;
-    serializeJson(json, buff);
-    LOG(println, buff.c_str());
-    if (send_hndl) send_hndl->send(buff);
+#ifdef EMBUI_DEBUG
+    serializeJson(json, Serial);
+    Serial.println();
+#endif
+    METRIC_INC(M_UI_FRAMES);
+    if (send_hndl) send_hndl->send(json);
 }
 
 void Interface::json_section_menu(){
@@ -7,33 +7,102 @@
 #define ui_h
 
 #include "EmbUI.h"
+#include <new>
 //#include <ESPAsyncWebServer.h>
 //#include "ArduinoJson.h"
 //#include "LList.h"
 
 class frameSend {
+    protected:
+        static void sent(size_t len){ METRIC_INC(M_WS_OUT_MSGS); METRIC_ADD(M_WS_OUT_BYTES, len); }
     public:
         virtual ~frameSend(){};
         virtual void send(const String &data){};
+        virtual void send(const JsonDocument &data){};
         virtual void flush(){}
 };
 
+/**
+ * отправка фрейма всем клиентам
+ * фрейм сериализуется сразу в буфер сообщения AsyncWebSocket, без промежуточного String
+ * если все подключенные клиенты согласовали MessagePack, фрейм уходит бинарным сообщением
+ */
 class frameSendAll: public frameSend {
     private:
         AsyncWebSocket *ws;
     public:
         frameSendAll(AsyncWebSocket *server){ ws = server; }
         ~frameSendAll() { ws = nullptr; }
-        void send(const String &data){ if (data.length()) ws->textAll(data); };
+        void send(const String &data){ if (data.length()) { ws->textAll(data); sent(data.length()); } };
+        void send(const JsonDocument &data){
+            if (embui.ws_allbinary()) {
+                size_t len = measureMsgPack(data);
+                AsyncWebSocketMessageBuffer *buffer = ws->makeBuffer(len);
+                if (!buffer) return;
+                serializeMsgPack(data, (char*)buffer->get(), len);
+                ws->binaryAll(buffer);
+                sent(len);
+                return;
+            }
+            size_t len = measureJson(data);
+            AsyncWebSocketMessageBuffer *buffer = ws->makeBuffer(len);  // буфер размером len+1
+            if (!buffer) return;
+            serializeJson(data, (char*)buffer->get(), len + 1);
+            ws->textAll(buffer);
+            sent(len);
+        };
 };
 
+/**
+ * отправка фрейма одному клиенту
+ * фрейм сериализуется сразу в буфер сообщения AsyncWebSocket, как у frameSendAll, без промежуточных копий
+ * формат (JSON/MessagePack) выбирается по тому, что клиент согласовал при подключении
+ */
 class frameSendClient: public frameSend {
-    private:
+    protected:
         AsyncWebSocketClient *cl;
     public:
         frameSendClient(AsyncWebSocketClient *client){ cl = client; }
         ~frameSendClient() { cl = nullptr; }
-        void send(const String &data){ if (data.length()) cl->text(data); };
+        void send(const String &data){ if (data.length()) { cl->text(data); sent(data.length()); } };
+        void send(const JsonDocument &data){
+            bool bin = embui.ws_isbinary(cl->id());
+            size_t len = bin ? measureMsgPack(data) : measureJson(data);
+            AsyncWebSocketMessageBuffer *buffer = cl->server()->makeBuffer(len);  // буфер размером len+1
+            if (!buffer) return;
+            if (bin) {
+                serializeMsgPack(data, (char*)buffer->get(), len);
+                cl->binary(buffer);
+            } else {
+                serializeJson(data, (char*)buffer->get(), len + 1);
+                cl->text(buffer);
+            }
+            sent(len);
+        };
+};
+
+/**
+ * отправка фрейма одному клиенту с записью в кэш фреймов
+ * фрейм сериализуется сразу в буфер кэша, при переполнении кэша отправка идет как у frameSendClient
+ */
+class frameSendCache: public frameSendClient {
+    private:
+        FrameCache *cache;
+    public:
+        frameSendCache(AsyncWebSocketClient *client, FrameCache *c) : frameSendClient(client) { cache = c; }
+        ~frameSendCache() { cache = nullptr; }
+        void send(const String &data){ frameSendClient::send(data); cache->abort(); };
+        void send(const JsonDocument &data){
+            size_t len = measureJson(data);
+            char *buff = cache->reserve(len);
+            if (!buff) {
+                frameSendClient::send(data);
+                return;
+            }
+            serializeJson(data, buff, len + 1);
+            cl->text(buff, len);
+            sent(len);
+        };
 };
 
 class frameSendHttp: public frameSend {
@@ -51,6 +120,9 @@ class frameSendHttp: public frameSend {
             if (!data.length()) return;
             stream->print(data);
         };
+        void send(const JsonDocument &data){
+            serializeJson(data, *stream);   // пишем прямо в поток ответа
+        };
         void flush(){
             req->send(stream);
         };
@@ -63,31 +135,79 @@ class Interface {
       int idx;
     } section_stack_t;
 
-    DynamicJsonDocument json;
+    // место под транспорт внутри Interface, стандартные транспорты создаются без new
+    typedef union transport_store_t {
+        char all[sizeof(frameSendAll)];
+        char client[sizeof(frameSendClient)];
+        char cache[sizeof(frameSendCache)];
+        char http[sizeof(frameSendHttp)];
+        void *align;
+    } transport_store_t;
+
+    char *jbuf;                 // буфер документа из framepool
+    FrameDocument json;
     LList<section_stack_t*> section_stack;
+    transport_store_t tstore;
     frameSend *send_hndl;
     EmbUI *embui;
+    bool towned = false;        // транспорт передан снаружи и удаляется через delete
+    bool broadcast = false;     // фреймы уходят всем клиентам, значения учитываются в таблице публикаций
+    bool delta = false;         // value() пропускает значения, не изменившиеся с прошлой публикации
+    bool objretry = false;      // элемент из json_frame_obj() есть смысл повторить в новом фрейме
+    size_t framebase = 0;       // занято документом сразу после json_frame_next()
+
+    JsonObject json_frame_obj(size_t size);
+    bool json_frame_done();
+
+    Interface(const Interface&);            // noncopyable: буфер и транспорт принадлежат одному объекту
+    Interface& operator=(const Interface&);
 
     public:
-        Interface(EmbUI *j, AsyncWebSocket *server, size_t size = 3000): json(size), section_stack(){
+        /**
+         * Interface можно создавать на стеке: документ берется из пула буферов, транспорт хранится внутри объекта
+         */
+        Interface(EmbUI *j, AsyncWebSocket *server, size_t size = 3000): jbuf(framepool.lease(size)), json(jbuf, jbuf ? size : 0), section_stack(){
             embui = j;
-            send_hndl = new frameSendAll(server);
+            send_hndl = new (&tstore) frameSendAll(server);
+            broadcast = true;
         }
-        Interface(EmbUI *j, AsyncWebSocketClient *client, size_t size = 3000): json(size), section_stack(){
+        Interface(EmbUI *j, AsyncWebSocketClient *client, size_t size = 3000): jbuf(framepool.lease(size)), json(jbuf, jbuf ? size : 0), section_stack(){
             embui = j;
-            send_hndl = new frameSendClient(client);
+            send_hndl = new (&tstore) frameSendClient(client);
         }
-        Interface(EmbUI *j, AsyncWebServerRequest *request, size_t size = 3000): json(size), section_stack(){
+        Interface(EmbUI *j, AsyncWebSocketClient *client, FrameCache *cache, size_t size = 3000): jbuf(framepool.lease(size)), json(jbuf, jbuf ? size : 0), section_stack(){
             embui = j;
-            send_hndl = new frameSendHttp(request);
+            send_hndl = new (&tstore) frameSendCache(client, cache);
+        }
+        Interface(EmbUI *j, AsyncWebServerRequest *request, size_t size = 3000): jbuf(framepool.lease(size)), json(jbuf, jbuf ? size : 0), section_stack(){
+            embui = j;
+            send_hndl = new (&tstore) frameSendHttp(request);
+        }
+        /**
+         * произвольный транспорт, объект транспорта переходит во владение Interface
+         */
+        Interface(EmbUI *j, frameSend *transport, size_t size = 3000): jbuf(framepool.lease(size)), json(jbuf, jbuf ? size : 0), section_stack(){
+            embui = j;
+            send_hndl = transport;
+            towned = true;
         }
         ~Interface(){
-            delete send_hndl;
+            METRIC_INC(M_UI_RENDERS);
+            heapmon.tag(HEAP_RENDER);
+            heapmon.mark();         // документ еще не освобожден
+            if (towned) delete send_hndl;
+            else send_hndl->~frameSend();
             send_hndl = nullptr;
             embui = nullptr;
+            framepool.release(jbuf);
         }
 
         void json_frame_value();
+        /**
+         * режим публикации изменений: value() отправляет только значения, изменившиеся с прошлой
+         * рассылки всем клиентам, пустой value-фрейм не отправляется вовсе
+         */
+        void json_frame_delta(bool on = true){ delta = on; }
         void json_frame_interface(const String &name = "");
         bool json_frame_add(JsonObject obj);
         void json_frame_next();
@@ -147,6 +267,7 @@ class Interface {
         void button_submit_value(const String &section, const String &value, const String &label, const String &color = "");
         void spacer(const String &label = "");
         void comment(const String &label = "");
+        void comment(const String &id, const String &label);    // с id содержимое можно заменить value(id, html, true)
 };
 
 #endif
\ No newline at end of file
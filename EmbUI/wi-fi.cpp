@@ -10,19 +10,27 @@
 #include "timeProcessor.h"
 
 #ifdef ESP8266
+#include <Schedule.h>     // schedule_function()
+
 void EmbUI::onSTAConnected(WiFiEventStationModeConnected ipInfo)
 {
     LOG(printf_P, PSTR("UI WiFi: connected to %s\r\n"), ipInfo.ssid.c_str());
 }
 
+/**
+ * обработчики событий WiFi вызываются из контекста SDK, а не из loop(): колесо таймеров, кеш фреймов и mDNS
+ * трогаются только из loop(), поэтому вся работа откладывается через schedule_function()
+ */
 void EmbUI::onSTAGotIP(WiFiEventStationModeGotIP ipInfo)
 {
-    wifi_setmode(WIFI_STA);            // Shutdown internal Access Point
-    sysData.wifi_sta = true;
-    embuischedw.detach();
-    LOG(printf_P, PSTR("WiFi: Got IP: %s\r\n"), ipInfo.ip.toString().c_str());
-    setup_mDns();
-    timeProcessor.onSTAGotIP(ipInfo);
+    schedule_function([this, ipInfo](){
+        wifi_setmode(WIFI_STA);            // Shutdown internal Access Point
+        sysData.wifi_sta = true;
+        embuischedw.detach();
+        LOG(printf_P, PSTR("WiFi: Got IP: %s\r\n"), ipInfo.ip.toString().c_str());
+        setup_mDns();
+        timeProcessor.onSTAGotIP(ipInfo);
+    });
 }
 
 void EmbUI::setup_mDns(){
@@ -46,20 +54,23 @@ void EmbUI::setup_mDns(){
 
 void EmbUI::onSTADisconnected(WiFiEventStationModeDisconnected event_info)
 {
-    if (embuischedw.active() && (WiFi.getMode()==WIFI_AP || WiFi.getMode()==WIFI_AP_STA || !sysData.wifi_sta))
-        return;
-    
-    LOG(printf_P, PSTR("UI WiFi: Disconnected from SSID: %s, reason: %d\n"), event_info.ssid.c_str(), event_info.reason);
-    sysData.wifi_sta = false;
+    schedule_function([this, event_info](){
+        if (embuischedw.active() && (WiFi.getMode()==WIFI_AP || WiFi.getMode()==WIFI_AP_STA || !sysData.wifi_sta))
+            return;
 
-    embuischedw.once_scheduled(WIFI_CONNECT_TIMEOUT, [this](){
+        LOG(printf_P, PSTR("UI WiFi: Disconnected from SSID: %s, reason: %d\n"), event_info.ssid.c_str(), event_info.reason);
         sysData.wifi_sta = false;
-        LOG(println, F("UI WiFi: enabling internal AP"));
-        wifi_setmode(WIFI_AP);  // Enable internal AP if station connection is lost
-        embuischedw.once_scheduled(WIFI_RECONNECT_TIMER, [this](){wifi_setmode(WIFI_AP_STA); WiFi.begin(); setup_mDns();} );
-    } );
+        framecache.invalidate();
+
+        embuischedw.once(WIFI_CONNECT_TIMEOUT * 1000UL, [this](){
+            sysData.wifi_sta = false;
+            LOG(println, F("UI WiFi: enabling internal AP"));
+            wifi_setmode(WIFI_AP);  // Enable internal AP if station connection is lost
+            embuischedw.once(WIFI_RECONNECT_TIMER * 1000UL, [this](){wifi_setmode(WIFI_AP_STA); WiFi.begin(); setup_mDns();} );
+        } );
 
-    timeProcessor.onSTADisconnected(event_info);
+        timeProcessor.onSTADisconnected(event_info);
+    });
 }
 #else
 // need to test it under ESP32 (might not need any scheduler to handle both Client and AP at the same time)
@@ -126,6 +137,7 @@ void EmbUI::wifi_connect(const char *ssid, const char *pwd)
 void EmbUI::wifi_setmode(WiFiMode mode){
     LOG(printf_P, PSTR("WiFi: set mode: %d\n"), mode);
     WiFi.mode(mode);
+    framecache.invalidate();    // главная секция зависит от режима WiFi и SSID, смена режима их и меняет
 }
 
 /**
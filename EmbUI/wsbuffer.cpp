@@ -0,0 +1,74 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#include "wsbuffer.h"
+
+WsBufferPool::WsBufferPool() : json(EMBUI_WSDOC_SIZE){
+    memset(bufs, 0, sizeof(bufs));
+}
+
+WsBufferPool::wsbuf_t *WsBufferPool::find(uint32_t client){
+    for (int i = 0; i < EMBUI_WSBUF_POOL; i++) {
+        if (bufs[i].client == client) return &bufs[i];
+    }
+    return nullptr;
+}
+
+char *WsBufferPool::append(uint32_t client, AwsFrameInfo *info, uint8_t *data, size_t len, size_t *msglen, uint8_t *opcode){
+    wsbuf_t *b = find(client);
+
+    if (info->num == 0 && info->index == 0) {
+        // начало нового сообщения, незавершенное предыдущее отбрасывается
+        if (!b) b = find(0);
+        if (!b) {
+            LOG(printf_P, PSTR("UI: ws[%u] no free buffer, message dropped\n"), client);
+            return nullptr;
+        }
+        b->client = client;
+        b->opcode = info->message_opcode;
+        b->len = 0;
+    }
+    if (!b) return nullptr;     // продолжение сообщения, начало которого не было принято
+
+    size_t need = b->len + len + 1;
+    if (info->index == 0 && info->final) need = b->len + info->len + 1;     // размер последнего кадра известен
+    if (need > EMBUI_WSBUF_MAX + 1) {
+        LOG(printf_P, PSTR("UI: ws[%u] message exceeds %u bytes, dropped\n"), client, EMBUI_WSBUF_MAX);
+        release(client);
+        return nullptr;
+    }
+    if (need > b->cap) {
+        char *p = (char*)realloc(b->data, need);
+        if (!p) {
+            release(client);
+            return nullptr;
+        }
+        b->data = p;
+        b->cap = need;
+    }
+
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+
+    if (!info->final || info->index + len != info->len) return nullptr;
+
+    b->data[b->len] = '\0';
+    *msglen = b->len;
+    *opcode = b->opcode;
+    return b->data;
+}
+
+void WsBufferPool::release(uint32_t client){
+    wsbuf_t *b = find(client);
+    if (!b) return;
+    b->client = 0;
+    b->len = 0;
+    // редкое большое сообщение не должно держать память, пока клиенты шлют короткие
+    if (b->cap > EMBUI_WSBUF_KEEP) {
+        free(b->data);
+        b->data = nullptr;
+        b->cap = 0;
+    }
+}
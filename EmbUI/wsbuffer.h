@@ -0,0 +1,68 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+#include "globals.h"
+#include <ArduinoJson.h>
+
+#ifdef ESP8266
+ #include <ESPAsyncTCP.h>
+#else
+ #include <AsyncTCP.h>
+#endif
+#include <ESPAsyncWebServer.h>
+
+#ifndef EMBUI_WSBUF_POOL
+#define EMBUI_WSBUF_POOL    2       // сколько клиентов одновременно могут передавать фрагментированные сообщения
+#endif
+
+#ifndef EMBUI_WSBUF_MAX
+#define EMBUI_WSBUF_MAX     4096    // максимальный размер собираемого ws-сообщения, байт
+#endif
+
+#ifndef EMBUI_WSBUF_KEEP
+#define EMBUI_WSBUF_KEEP    512     // буфер больше этого освобождается после сборки сообщения, меньший остается в пуле
+#endif
+
+#ifndef EMBUI_WSDOC_SIZE
+#define EMBUI_WSDOC_SIZE    JSON_OBJECT_SIZE(48)    // документ разбора входящего сообщения (строки остаются в буфере)
+#endif
+
+/**
+ * Сборка ws-сообщений, пришедших несколькими фрагментами или TCP-сегментами
+ * буферы закрепляются за клиентом на время сборки и после возвращаются в пул, память остается только у буферов до EMBUI_WSBUF_KEEP.
+ * Документ для разбора сообщений общий и выделяется один раз, разбор идет на месте (zero-copy)
+ */
+class WsBufferPool {
+    typedef struct wsbuf_t {
+        uint32_t client;    // 0 - буфер свободен
+        uint8_t opcode;
+        char *data;
+        size_t cap;
+        size_t len;
+    } wsbuf_t;
+
+    wsbuf_t bufs[EMBUI_WSBUF_POOL];
+    DynamicJsonDocument json;
+
+    wsbuf_t *find(uint32_t client);
+
+  public:
+    WsBufferPool();
+
+    /**
+     * добавить фрагмент сообщения клиента
+     * @return собранное сообщение (с завершающим '\0'), когда пришел последний фрагмент, иначе nullptr
+     */
+    char *append(uint32_t client, AwsFrameInfo *info, uint8_t *data, size_t len, size_t *msglen, uint8_t *opcode);
+
+    /**
+     * вернуть буфер клиента в пул (по окончании сообщения или отключении), большой буфер освобождается
+     */
+    void release(uint32_t client);
+
+    JsonDocument &doc(){ json.clear(); return json; }
+};
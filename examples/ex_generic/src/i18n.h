@@ -29,6 +29,7 @@ enum TD : uint8_t {
     D_EVENT,
     D_EXIT,
     D_FWLOAD,
+    D_HEAP,
     D_HOLD,
     D_Hostname,
     D_LARROW,
@@ -100,6 +101,7 @@ static const char T_EN_EDIT[] PROGMEM = "Edit";
 static const char T_EN_EVENT[] PROGMEM = "Event";
 static const char T_EN_EXIT[] PROGMEM = "Exit";
 static const char T_EN_FWLOAD[] PROGMEM = "Upload firmware/FS image";
+static const char T_EN_HEAP[] PROGMEM = "Heap memory";
 static const char T_EN_HOLD[] PROGMEM = "Hold";
 static const char T_EN_Hostname[] PROGMEM = "Hostname (mDNS Hostname/AP-SSID)";
 static const char T_EN_LARROW[] PROGMEM = "<<<";
@@ -167,6 +169,7 @@ static const char T_RU_EDIT[] PROGMEM = "Редактировать";
 static const char T_RU_EVENT[] PROGMEM = "Событие";
 static const char T_RU_EXIT[] PROGMEM = "Выход";
 static const char T_RU_FWLOAD[] PROGMEM = "Загрузка прошивки/образа FS";
+static const char T_RU_HEAP[] PROGMEM = "Память";
 static const char T_RU_HOLD[] PROGMEM = "Удержание";
 static const char T_RU_Hostname[] PROGMEM = "Имя хоста (mDNS Hostname/AP-SSID)";
 static const char T_RU_LOAD[] PROGMEM = "Загрузить";
@@ -234,6 +237,7 @@ static const char *const T_DICT[][DICT_SIZE] PROGMEM = {
     T_RU_EVENT,
     T_RU_EXIT,
     T_RU_FWLOAD,
+    T_RU_HEAP,
     T_RU_HOLD,
     T_RU_Hostname,
     T_EN_LARROW,
@@ -302,6 +306,7 @@ static const char *const T_DICT[][DICT_SIZE] PROGMEM = {
     T_EN_EVENT,
     T_EN_EXIT,
     T_EN_FWLOAD,
+    T_EN_HEAP,
     T_EN_HOLD,
     T_EN_Hostname,
     T_EN_LARROW,
@@ -25,7 +25,7 @@ void create_parameters(){
 
     // параметры подключения к MQTT
     embui.var_create(FPSTR(P_m_host), "");                   // MQTT server hostname
-    embui.var_create(FPSTR(P_m_port), F("1883"));            // MQTT port
+    embui.var_create(FPSTR(P_m_port), F("1883"), CFG_INT);   // MQTT port
 
     embui.var_create(FPSTR(P_m_user), "");                   // MQTT login
     embui.var_create(FPSTR(P_m_pass), "");                   // MQTT pass
@@ -47,6 +47,10 @@ void create_parameters(){
     embui.section_handle_add(FPSTR(T_SH_NETW), block_settings_netw);        // generate "network settings" UI section
     embui.section_handle_add(FPSTR(T_SH_TIME), block_settings_time);         // generate "time settings" UI section
     //embui.section_handle_add(FPSTR(T_SH_OTHER), show_settings_other);
+#ifdef EMBUI_PROFILER
+    embui.section_handle_add(FPSTR(T_SH_PROF), block_profiler);             // generate "profiler" UI section
+#endif
+    embui.section_handle_add(FPSTR(T_SH_HEAP), block_heapmon);              // generate "heap monitor" UI section
 
     // обработка базовых настроек
     embui.section_handle_add(FPSTR(T_SET_WIFI), set_settings_wifi);         // обработка настроек WiFi Client
@@ -92,8 +96,7 @@ void section_main_frame(Interface *interf, JsonObject *data){
  */
 void block_menu(Interface *interf, JsonObject *data){
     if (!interf) return;
-    // создаем меню
-    embui.autoSaveReset(); // автосохранение конфига будет отсчитываться от этого момента
+    // создаем меню, автосохранение при открытии интерфейса отодвигает сам EmbUI
     interf->json_section_menu();
 
     //interf->option(FPSTR(T_DEMO), FPSTR(T_DICT[lang][TD::D_OTHER));
@@ -124,6 +127,10 @@ void section_settings_frame(Interface *interf, JsonObject *data){
     interf->button(FPSTR(T_SH_NETW), FPSTR(T_DICT[lang][TD::D_WIFI_MQTT]));  // кнопка перехода в настройки сети
     interf->button(FPSTR(T_SH_TIME), FPSTR(T_DICT[lang][TD::D_Time]));       // кнопка перехода в настройки времени
     interf->button(FPSTR(T_SH_OTHER), FPSTR(T_DICT[lang][TD::D_OTHER]));     // кнопка перехода в другие настройки
+#ifdef EMBUI_PROFILER
+    interf->button(FPSTR(T_SH_PROF), FPSTR(T_DICT[lang][TD::D_DEBUG]));      // кнопка перехода в профилировщик
+#endif
+    interf->button(FPSTR(T_SH_HEAP), FPSTR(T_DICT[lang][TD::D_HEAP]));       // кнопка перехода в монитор кучи
 
     interf->spacer();
     block_settings_update(interf, data);                                   // вызываем блок интерфейса обновления ПО
@@ -220,6 +227,43 @@ void block_settings_time(Interface *interf, JsonObject *data){
     interf->json_frame_flush();
 }
 
+/**
+ *  WebUI блок профилировщика handle(): время этапов, кнопка обновляет значения
+ */
+void block_profiler(Interface *interf, JsonObject *data){
+    if (!interf) return;
+#ifdef EMBUI_PROFILER
+    interf->json_frame_interface();
+    interf->json_section_main(FPSTR(T_SH_PROF), FPSTR(T_DICT[lang][TD::D_DEBUG]));
+
+    profiler.ui(interf);
+    interf->button(FPSTR(T_SH_PROF), FPSTR(T_DICT[lang][TD::D_REFRESH]));
+
+    interf->spacer();
+    interf->button(FPSTR(T_SETTINGS), FPSTR(T_DICT[lang][TD::D_EXIT]));
+
+    interf->json_section_end();
+    interf->json_frame_flush();
+#endif
+}
+
+/**
+ *  WebUI блок монитора кучи: после открытия секции график сам обновляется EMBUI_HEAPMON_LIVE мс
+ */
+void block_heapmon(Interface *interf, JsonObject *data){
+    if (!interf) return;
+    interf->json_frame_interface();
+    interf->json_section_main(FPSTR(T_SH_HEAP), FPSTR(T_DICT[lang][TD::D_HEAP]));
+
+    heapmon.ui(interf);
+
+    interf->spacer();
+    interf->button(FPSTR(T_SETTINGS), FPSTR(T_DICT[lang][TD::D_EXIT]));
+
+    interf->json_section_end();
+    interf->json_frame_flush();
+}
+
 /**
  * Обработчик настроек WiFi в режиме клиента
  */
@@ -283,8 +327,8 @@ void set_settings_time(Interface *interf, JsonObject *data){
     String datetime=(*data)[FPSTR(T_DTIME)];
     if (datetime.length())
         embui.timeProcessor.setTime(datetime);
-    SETPARAM(FPSTR(P_TZSET), embui.timeProcessor.tzsetup((*data)[FPSTR(P_TZSET)]));
-    SETPARAM(FPSTR(P_userntp), embui.timeProcessor.setcustomntp((*data)[FPSTR(P_userntp)]));
+    SETPARAM(FPSTR(P_TZSET));       // правила TZ и NTP-сервер применит сам EmbUI, он следит за этими ключами
+    SETPARAM(FPSTR(P_userntp));
 
     section_settings_frame(interf, data);
 }
@@ -294,6 +338,7 @@ void set_language(Interface *interf, JsonObject *data){
 
     //lang = (*data)[FPSTR(T_LANGUAGE)].as<unsigned char>();
     SETPARAM(FPSTR(T_LANGUAGE), lang = (*data)[FPSTR(T_LANGUAGE)].as<unsigned char>() );
+    embui.framecache.invalidate();      // главная секция построена на тексте другого языка
 
     section_settings_frame(interf, data);
 }
@@ -13,6 +13,8 @@ void block_menu(Interface *interf, JsonObject *data);
 void block_settings_netw(Interface *interf, JsonObject *data);
 void block_settings_update(Interface *interf, JsonObject *data);
 void block_settings_time(Interface *interf, JsonObject *data);
+void block_profiler(Interface *interf, JsonObject *data);
+void block_heapmon(Interface *interf, JsonObject *data);
 
 void section_settings_frame(Interface *interf, JsonObject *data);
 void set_settings_wifi(Interface *interf, JsonObject *data);
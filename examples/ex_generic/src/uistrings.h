@@ -24,6 +24,8 @@ static const char T_SET_TIME[] PROGMEM = "set_time";
 static const char T_SH_NETW[] PROGMEM = "sh_netw";
 static const char T_SH_TIME[] PROGMEM = "sh_time";
 static const char T_SH_OTHER[] PROGMEM = "sh_other";
+static const char T_SH_PROF[] PROGMEM = "sh_prof";
+static const char T_SH_HEAP[] PROGMEM = "sh_heap";
 
 // WiFi vars
 static const char T_WCSSID[] PROGMEM = "wcssid";
@@ -408,10 +408,115 @@ var mustache = function(tmpl,func){
 	}
 }(mustache.prototype));
 
+var msgpack = {
+	decode: function(buf){
+		var dv = new DataView(buf), bytes = new Uint8Array(buf), pos = 0,
+		utf8 = function(len){
+			var out = "", end = pos + len;
+			while (pos < end) {
+				var c = bytes[pos++];
+				if (c > 239) {
+					c = ((c & 7) << 18 | (bytes[pos++] & 63) << 12 | (bytes[pos++] & 63) << 6 | (bytes[pos++] & 63)) - 0x10000;
+					out += String.fromCharCode(0xd800 + (c >> 10), 0xdc00 + (c & 1023));
+					continue;
+				}
+				if (c > 223) c = (c & 15) << 12 | (bytes[pos++] & 63) << 6 | (bytes[pos++] & 63);
+				else if (c > 191) c = (c & 31) << 6 | (bytes[pos++] & 63);
+				out += String.fromCharCode(c);
+			}
+			return out;
+		},
+		arr = function(n){
+			var out = [];
+			for (var i = 0; i < n; i++) out.push(item());
+			return out;
+		},
+		map = function(n){
+			var out = {};
+			for (var i = 0; i < n; i++) { var k = item(); out[k] = item(); }
+			return out;
+		},
+		num = function(fn, n){ var v = dv[fn](pos); pos += n; return v; },
+		item = function(){
+			var t = bytes[pos++];
+			if (t < 0x80) return t;
+			if (t < 0x90) return map(t & 15);
+			if (t < 0xa0) return arr(t & 15);
+			if (t < 0xc0) return utf8(t & 31);
+			if (t > 0xdf) return t - 256;
+			switch (t) {
+				case 0xc0: return null;
+				case 0xc2: return false;
+				case 0xc3: return true;
+				case 0xca: return num("getFloat32", 4);
+				case 0xcb: return num("getFloat64", 8);
+				case 0xcc: return num("getUint8", 1);
+				case 0xcd: return num("getUint16", 2);
+				case 0xce: return num("getUint32", 4);
+				case 0xcf: return num("getUint32", 4) * 4294967296 + num("getUint32", 4);
+				case 0xd0: return num("getInt8", 1);
+				case 0xd1: return num("getInt16", 2);
+				case 0xd2: return num("getInt32", 4);
+				case 0xd3: return num("getInt32", 4) * 4294967296 + num("getUint32", 4);
+				case 0xd9: return utf8(num("getUint8", 1));
+				case 0xda: return utf8(num("getUint16", 2));
+				case 0xdb: return utf8(num("getUint32", 4));
+				case 0xdc: return arr(num("getUint16", 2));
+				case 0xdd: return arr(num("getUint32", 4));
+				case 0xde: return map(num("getUint16", 2));
+				case 0xdf: return map(num("getUint32", 4));
+			}
+			throw "msgpack: unsupported type " + t;
+		};
+		return item();
+	},
+	encode: function(val){
+		var out = [],
+		be = function(v, n){ while (n--) out.push(Math.floor(v / Math.pow(2, 8 * n)) & 255); },
+		len = function(n, fix, fmax, c8, c16, c32){
+			if (n <= fmax) out.push(fix | n);
+			else if (c8 && n < 256) { out.push(c8); be(n, 1); }
+			else if (n < 65536) { out.push(c16); be(n, 2); }
+			else { out.push(c32); be(n, 4); }
+		},
+		item = function(v){
+			var i;
+			if (v === null || typeof v == "undefined") out.push(0xc0);
+			else if (typeof v == "boolean") out.push(v? 0xc3 : 0xc2);
+			else if (typeof v == "number") {
+				if (Math.floor(v) === v && v >= 0 && v < 4294967296) {
+					if (v < 128) out.push(v); else { out.push(0xce); be(v, 4); }
+				} else if (Math.floor(v) === v && v < 0 && v >= -2147483648) {
+					if (v >= -32) out.push(v & 255); else { out.push(0xd2); be(v >>> 0, 4); }
+				} else {
+					var b = new Uint8Array(8);
+					new DataView(b.buffer).setFloat64(0, v);
+					out.push(0xcb);
+					for (i = 0; i < 8; i++) out.push(b[i]);
+				}
+			} else if (typeof v == "string") {
+				var s = unescape(encodeURIComponent(v));
+				len(s.length, 0xa0, 31, 0xd9, 0xda, 0xdb);
+				for (i = 0; i < s.length; i++) out.push(s.charCodeAt(i));
+			} else if (v instanceof Array) {
+				len(v.length, 0x90, 15, 0, 0xdc, 0xdd);
+				for (i = 0; i < v.length; i++) item(v[i]);
+			} else {
+				var k = Object.keys(v);
+				len(k.length, 0x80, 15, 0, 0xde, 0xdf);
+				for (i = 0; i < k.length; i++) { item(k[i]); item(v[k[i]]); }
+			}
+		};
+		item(val);
+		return new Uint8Array(out).buffer;
+	}
+}
+
 var wbs = function(url){
-	var ws = null, frame = {}, connected = false, lastmsg = null, to = null,
+	var ws = null, frame = {}, connected = false, lastmsg = null, to = null, bin = false,
 	open = function(fnopen, fnerror){
 		ws = new WebSocket(url);
+		ws.binaryType = "arraybuffer";
 		ws.onerror = function(err){
 			console.log("WS Error", err);
 			if (fnerror) fnerror(err);
@@ -421,7 +526,8 @@ var wbs = function(url){
 		}
 		ws.onopen = function(){
 			console.log("WS Open");
-			connected = true;
+			connected = true; bin = false;
+			send(JSON.stringify({pkg:"proto", data:"msgpack"}));
 			if (fnopen) fnopen();
 			if (typeof out.onopen== "function") {
 				try{ out.onopen(); } catch(e){ console.log('Error onopen', e); }
@@ -435,9 +541,15 @@ var wbs = function(url){
 			}
 		}
 		ws.onmessage = function(msg){
-			try{ msg = JSON.parse(msg.data); } catch(e){ console.log('Error message', e); return; }
+			try{
+				msg = (msg.data instanceof ArrayBuffer)? msgpack.decode(msg.data) : JSON.parse(msg.data);
+			} catch(e){ console.log('Error message', e); return; }
 			console.log('Received message:', msg);
 			if (!(msg instanceof Object)) return;
+			if (msg.pkg == "proto") {
+				bin = (msg.data == "msgpack");
+				return;
+			}
 			if (msg.section) {
 				if (!frame[msg.section]) frame[msg.section] = {};
 				go.merge(frame[msg.section], msg);
@@ -459,7 +571,7 @@ var wbs = function(url){
 	send = function(msg){ try{ ws.send(msg); }catch(e){} },
 	send_msg = function(msg){
 		console.log('Sending message:', msg);
-		try{ lastmsg = JSON.stringify(msg); } catch(e){ console.log('Error stringify', e); return; }
+		try{ lastmsg = bin? msgpack.encode(msg) : JSON.stringify(msg); } catch(e){ console.log('Error stringify', e); return; }
 		if (connected) send(lastmsg);
 	},
 
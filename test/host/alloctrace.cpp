@@ -0,0 +1,115 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * AllocTrace на хосте: new/delete и malloc перехвачены теми же флагами --wrap, что и в [env:alloctrace] примера
+ * (имена new/delete для 64-битного size_t, см. alloctrace.h)
+ *
+ * Прогоняется то, что из примера ex_generic собирается без сети: его параметры и обработчики секций
+ * (ключи и имена из uistrings.h), разбор ключей post, изменения настроек и запись /config.json,
+ * в конце печатаются места с наибольшим числом выделений. Адреса без PIE, имя функции дает
+ *   addr2line -fe _gate_build/alloctrace 0x...
+ */
+#include "hosttest.h"
+#include "alloctrace.h"
+#include "config.h"
+#include "sectionindex.h"
+#include "uistrings.h"
+#include <new>
+
+typedef struct section_handle_t {
+    String name;
+    void (*callback)(ConfigStore &cfg, const char *value);
+    uint32_t calls;
+} section_handle_t;
+
+// как SETPARAM в обработчиках примера: значение из post в конфиг
+static void setparam(ConfigStore &cfg, const char *value){ cfg.set(cfg.find(FPSTR(P_m_host)), value); }
+
+// /config.json целиком через CfgWriter, как в EmbUI::save()
+static void save(ConfigStore &cfg){
+    CfgWriter w;
+    w.begin(String(FPSTR(P_cfgfile)), FPSTR(P_cfgtmp));
+    w.stream(cfg, ConfigStore::cursor(CFG_OUT_JSON));
+    while (w.step() > 0);
+    cfg.clean();
+}
+
+static void example_ui(){
+    ConfigStore cfg;
+    SectionIndex<section_handle_t*> index;
+
+    // create_parameters() примера
+    const char *vars[] = {P_hostname, P_APonly, P_APpwd, P_m_host, P_m_port, P_m_user, P_m_pass, P_m_pref,
+        T_MPERIOD, P_TZSET, P_userntp, T_LANGUAGE, T_WCSSID, T_WCPASS};
+    for (const char *v : vars) cfg.create(FPSTR(v), "");
+
+    const char *sections[] = {T_SETTINGS, T_SH_NETW, T_SH_TIME, T_SH_HEAP, T_SET_WIFI, T_SET_WIFIAP,
+        T_SET_MQTT, T_SET_TIME, T_LANGUAGE, T_DO_OTAUPD};
+    const size_t nsections = sizeof(sections) / sizeof(sections[0]);
+    section_handle_t *handlers[nsections];
+    for (size_t i = 0; i < nsections; i++) {
+        handlers[i] = new section_handle_t{sections[i], setparam, 0};
+        index.add(handlers[i]);
+    }
+
+    // поток событий из интерфейса: каждое - разбор ключа, смена значения, время от времени сохранение
+    char value[32];
+    for (int ev = 0; ev < 200; ev++) {
+        section_handle_t *h = index.find(sections[ev % nsections]);
+        if (!h) continue;
+        ++h->calls;
+        snprintf(value, sizeof(value), "host-%d.local", ev);
+        h->callback(cfg, value);
+        if (ev % 50 == 49) save(cfg);
+    }
+
+    for (size_t i = 0; i < nsections; i++) delete handlers[i];
+}
+
+class StdoutPrint : public Print {
+  public:
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+int main(){
+    uint32_t base = alloctrace.live();
+
+    // учет по месту вызова
+    char *p = (char*)malloc(100);
+    CHECK(alloctrace.live() == base + 100);
+    p = (char*)realloc(p, 300);
+    CHECK(alloctrace.live() == base + 300);
+    free(p);
+    CHECK(alloctrace.live() == base);
+
+    uint8_t *z = (uint8_t*)calloc(64, 4);
+    size_t nz = 0;
+    for (size_t i = 0; i < 256; i++) nz += z[i] != 0;
+    CHECK(nz == 0);
+    free(z);
+
+    int *n = new int[16];
+    CHECK(alloctrace.live() == base + 16 * sizeof(int));
+    delete[] n;
+    int *nt = new (std::nothrow) int;
+    CHECK(alloctrace.live() == base + sizeof(int));
+    delete nt;
+
+    // блок, выделенный мимо перехвата (strdup внутри libc), освобождается как чужой
+    char *d = strdup("untracked");
+    free(d);
+    CHECK(alloctrace.live() == base);
+
+    alloctrace.reset();
+    example_ui();
+    LittleFS.files.clear();     // файлы заглушки ФС тоже в куче
+    CHECK(alloctrace.live() == base);
+    CHECK(alloctrace.peak() > base);
+
+    StdoutPrint out;
+    alloctrace.printTo(out, 10, AllocTrace::AT_BY_COUNT);
+    return host_result();
+}
@@ -0,0 +1,105 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * Button: симуляция кнопки на выводе с подтяжкой к питанию (нажата - LOW), опрос раз в EMBUI_BTN_POLL, как в EmbUI::btn()
+ */
+#include "hosttest.h"
+#include "gpio.h"
+#include <vector>
+
+/**
+ * вывод-заглушка: уровень задается фронтами (время, уровень), между фронтами держится
+ */
+class SimPin {
+    std::vector<std::pair<uint32_t, int>> edges;
+
+  public:
+    void edge(uint32_t t, int level){ edges.push_back({t, level}); }
+
+    // нажатие на ms, с дребезгом bounce мс на обоих фронтах: импульсы по 7 мс, чтобы опрос попадал на разные уровни
+    void press(uint32_t t, uint32_t ms, uint32_t bounce = 0){
+        for (uint32_t b = 0; b < bounce; b += 14) {
+            edge(t + b, LOW);
+            edge(t + b + 7, HIGH);
+        }
+        edge(t + bounce, LOW);
+        for (uint32_t b = 0; b < bounce; b += 14) {
+            edge(t + ms + b, HIGH);
+            edge(t + ms + b + 7, LOW);
+        }
+        edge(t + ms + bounce, HIGH);
+    }
+
+    int digitalRead(uint32_t now) const {
+        int level = HIGH;
+        for (auto &e : edges) {
+            if ((int32_t)(now - e.first) < 0) break;
+            level = e.second;
+        }
+        return level;
+    }
+};
+
+/**
+ * прогнать опрос с from до to, события - в том порядке, в каком их получил бы EmbUI::btn()
+ */
+static std::vector<btn_event_t> run(const SimPin &pin, uint32_t from, uint32_t to){
+    Button button;
+    std::vector<btn_event_t> ev;
+    for (uint32_t t = from; (int32_t)(to - t) >= 0; t += EMBUI_BTN_POLL) {
+        btn_event_t e = button.poll(!pin.digitalRead(t), t);
+        if (e != BTN_NONE) ev.push_back(e);
+    }
+    return ev;
+}
+
+typedef std::vector<btn_event_t> events;
+
+int main(){
+    {   // короткое нажатие с дребезгом
+        SimPin pin;
+        pin.press(1000, 300, 60);
+        CHECK(run(pin, 0, 3000) == (events{BTN_PRESS, BTN_SHORT}));
+    }
+    {   // помеха короче антидребезга событий не дает, даже если попала в два опроса подряд
+        SimPin pin;
+        pin.press(1000, 30);                    // больше EMBUI_BTN_POLL, меньше EMBUI_BTN_DEBOUNCE
+        CHECK(run(pin, 0, 3000).empty());
+    }
+    {   // удержание 6 с: переключение AP/STA взводится на BTN_LONG и применяется на отпускании
+        SimPin pin;
+        pin.press(1000, 6000, 60);
+        CHECK(run(pin, 0, 9000) == (events{BTN_PRESS, BTN_LONG, BTN_LONG_RELEASE}));
+    }
+    {   // удержание 16 с: сброс конфига, отпускание после него событий не дает
+        SimPin pin;
+        pin.press(1000, 16000);
+        CHECK(run(pin, 0, 20000) == (events{BTN_PRESS, BTN_LONG, BTN_VERYLONG}));
+    }
+    {   // два нажатия подряд
+        SimPin pin;
+        pin.press(1000, 200);
+        pin.press(1500, 200);
+        CHECK(run(pin, 0, 3000) == (events{BTN_PRESS, BTN_SHORT, BTN_PRESS, BTN_SHORT}));
+    }
+    {   // переполнение millis() во время удержания
+        SimPin pin;
+        uint32_t t0 = 0xFFFFFFFFUL - 2000;
+        pin.press(t0, 6000);
+        CHECK(run(pin, t0 - 1000, t0 + 8000) == (events{BTN_PRESS, BTN_LONG, BTN_LONG_RELEASE}));
+    }
+    {   // BTN_LONG приходит не позже чем через период опроса после порога
+        SimPin pin;
+        pin.press(1000, 20000);
+        Button button;
+        uint32_t at = 0;
+        for (uint32_t t = 0; t < 10000 && !at; t += EMBUI_BTN_POLL) {
+            if (button.poll(!pin.digitalRead(t), t) == BTN_LONG) at = t;
+        }
+        CHECK(at >= 1000 + EMBUI_BTN_LONG && at < 1000 + EMBUI_BTN_LONG + EMBUI_BTN_DEBOUNCE + EMBUI_BTN_POLL);
+    }
+    return host_result();
+}
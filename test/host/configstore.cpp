@@ -0,0 +1,176 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * ConfigStore: поиск через хэш-индекс, потоковая запись конфига и журнала
+ * и замер find() против прежнего прохода по таблице слотов для 50/200/1000 ключей
+ */
+#include "hosttest.h"
+#include "config.h"
+
+// прежний поиск: проход по всем слотам со сравнением хэшей
+static ConfigStore::cfg_slot_t *linear(ConfigStore &cfg, const cfgkey_t &key){
+    uint32_t h = key.hash();
+    for (uint16_t i = 0; i < cfg.size(); i++) {
+        ConfigStore::cfg_slot_t *s = cfg.at(i);
+        if (s->hash == h && ConfigStore::keyeq(s, key)) return s;
+    }
+    return nullptr;
+}
+
+static void test_index(){
+    static const char P_key[] PROGMEM = "pkey";
+    ConfigStore cfg;
+    char key[16];
+    for (int i = 0; i < 300; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        CHECK(cfg.create(key, key) != nullptr);
+    }
+    CHECK(cfg.size() == 300);
+    int found = 0;
+    for (int i = 0; i < 300; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        ConfigStore::cfg_slot_t *s = cfg.find(key);
+        found += s && !strcmp(s->str, key);
+    }
+    CHECK(found == 300);
+    CHECK(cfg.find("k300") == nullptr);
+
+    // ключ из PROGMEM находит тот же слот, что и строка в RAM
+    ConfigStore::cfg_slot_t *s = cfg.create(FPSTR(P_key), "1", CFG_INT);
+    CHECK(s && cfg.find("pkey") == s && cfg.find(FPSTR(P_key)) == s);
+    CHECK(cfg.get<int>(FPSTR(P_key)) == 1);
+
+    // create() существующего ключа значение не меняет
+    cfg.create("k5", "other");
+    CHECK(!strcmp(cfg.get<const char*>("k5"), "k5"));
+    CHECK(cfg.set(cfg.find("k5"), "new"));
+    CHECK(!cfg.set(cfg.find("k5"), "new"));
+    CHECK(!strcmp(cfg.get<const char*>("k5"), "new"));
+
+    // ключ длиннее CFG_KEY_LEN не создается
+    char longkey[CFG_KEY_LEN + 2];
+    memset(longkey, 'x', sizeof(longkey) - 1);
+    longkey[sizeof(longkey) - 1] = '\0';
+    CHECK(cfg.create(longkey, "v") == nullptr);
+}
+
+// CfgFile с тем же буфером, что и при записи на флеш, содержимое - строкой
+class StrPrint : public Print {
+  public:
+    std::string s;
+    size_t write(uint8_t c) override { s += (char)c; return 1; }
+};
+
+class StrStream : public Stream {
+    size_t pos = 0;
+
+  public:
+    std::string s;
+    StrStream(const std::string &d): s(d) {}
+    size_t write(uint8_t) override { return 0; }
+    int available() override { return s.size() - pos; }
+    int read() override { return pos < s.size() ? (uint8_t)s[pos++] : -1; }
+};
+
+static void test_stream(){
+    ConfigStore cfg;
+    cfg.create("a", "1");
+    cfg.create("b", "quote\"\\");
+    StrPrint json;
+    cfg.printTo(json);
+    CHECK(json.s == "{\"a\":\"1\",\"b\":\"quote\\\"\\\\\"}");
+
+    // журнал берет только измененные слоты и сбрасывает у них dirty
+    cfg.clean();
+    cfg.set(cfg.find("a"), "2");
+    StrPrint jnl;
+    ConfigStore::cfg_cursor_t c = ConfigStore::cursor(CFG_OUT_JOURNAL);
+    while (cfg.print(jnl, c));
+    CHECK(c.count == 1);
+    CHECK(!cfg.dirty());
+
+    ConfigStore copy;
+    copy.create("a", "1");
+    StrStream in(jnl.s + "\x4a\x01");       // недописанная запись в хвосте игнорируется
+    CHECK(copy.replay(in) == 1);
+    CHECK(!strcmp(copy.get<const char*>("a"), "2"));
+
+    // двоичный снимок пишется тем же проходом, что и json
+    StrPrint out, bin;
+    ConfigStore::cfg_cursor_t cb = ConfigStore::cursor(CFG_OUT_JSON);
+    while (cfg.print(out, cb, &bin));
+    ConfigStore::cfg_bintail_t tail = {};
+    tail.magic = CFG_BIN_MAGIC;
+    tail.version = CFG_BIN_VERSION;
+    tail.count = cb.count;
+    tail.bodylen = bin.s.size();
+    tail.crc = cfg_crc32(0, (const uint8_t*)bin.s.data(), bin.s.size());
+    bin.s.append((const char*)&tail, sizeof(tail));
+    ConfigStore restored;
+    CHECK(restored.fromBin((const uint8_t*)bin.s.data(), bin.s.size()));
+    CHECK(restored.size() == 2 && !strcmp(restored.get<const char*>("b"), "quote\"\\"));
+    bin.s[0] ^= 1;
+    CHECK(!ConfigStore().fromBin((const uint8_t*)bin.s.data(), bin.s.size()));
+}
+
+static void test_writer(){
+    ConfigStore cfg;
+    char key[16];
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        cfg.create(key, "value");
+    }
+    StrPrint expect;
+    cfg.printTo(expect);
+
+    // запись через временный файл порциями по EMBUI_CFG_CHUNK
+    CfgWriter w;
+    CHECK(w.begin(String("/config.json"), F("/config.tmp")));
+    w.stream(cfg, ConfigStore::cursor(CFG_OUT_JSON));
+    int steps = 0;
+    int8_t r;
+    while ((r = w.step()) > 0) ++steps;
+    CHECK(r == 0);
+    CHECK(steps >= (int)(expect.s.size() / EMBUI_CFG_CHUNK));
+    CHECK(!LittleFS.exists("/config.tmp"));
+    File f = LittleFS.open(String("/config.json"), "r");
+    std::string got(f.size(), '\0');
+    f.read((uint8_t*)&got[0], got.size());
+    CHECK(got == expect.s);
+}
+
+static void bench(int n, unsigned long iter){
+    ConfigStore cfg;
+    char key[24];
+    for (int i = 0; i < n; i++) {
+        snprintf(key, sizeof(key), "param_%d", i);
+        cfg.create(key, "0");
+    }
+
+    const int nkeys = 64;
+    String keys[nkeys];
+    for (int k = 0; k < nkeys; k++) {
+        snprintf(key, sizeof(key), "param_%d", (k * 97) % n);
+        keys[k] = key;
+    }
+    int same = 0;
+    for (int k = 0; k < nkeys; k++) same += linear(cfg, keys[k]) == cfg.find(keys[k]);
+    CHECK(same == nkeys);
+
+    double tl = host_bench(iter, [&](unsigned long i){ KEEP(linear(cfg, keys[i % nkeys])); });
+    double ti = host_bench(iter, [&](unsigned long i){ KEEP(cfg.find(keys[i % nkeys])); });
+    printf("%5d keys: linear %7.1f ns, index %6.1f ns per find()\n", n, tl, ti);
+}
+
+int main(int argc, char **argv){
+    test_index();
+    test_stream();
+    test_writer();
+
+    unsigned long iter = host_iterations(argc, argv, 20000);
+    for (int n : {50, 200, 1000}) bench(n, iter);
+    return host_result();
+}
@@ -0,0 +1,87 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * FramePool: выдача буферов документов Interface до и после begin(), промахи на занятом пуле и большом документе,
+ * повторное использование слотов, замер выдачи из пула против malloc/free
+ */
+#include "hosttest.h"
+#include "framepool.h"
+
+// пул, как и глобальный framepool, живет до конца программы и буферы не возвращает
+static void test_pool(){
+    static FramePool pool;
+
+    // до begin() все из кучи
+    char *h = pool.lease(512);
+    CHECK(h != nullptr);
+    CHECK(pool.stats().hits == 0 && pool.stats().misses == 1);
+    pool.release(h);
+    CHECK(pool.stats().used == 0);
+
+    pool.begin();
+    char *a = pool.lease(512);
+    char *b = pool.lease(EMBUI_FRAMEPOOL_SIZE);
+    CHECK(a && b && a != b);
+    CHECK(pool.stats().hits == 2 && pool.stats().used == 2 && pool.stats().peak == 2);
+
+    // пул занят: вложенный CALL_INTF получает буфер из кучи
+    char *c = pool.lease(512);
+    CHECK(c && c != a && c != b);
+    CHECK(pool.stats().misses == 2 && pool.stats().used == 2);
+    pool.release(c);
+
+    // освобожденный слот выдается снова
+    pool.release(a);
+    CHECK(pool.stats().used == 1);
+    char *a2 = pool.lease(100);
+    CHECK(a2 == a);
+    pool.release(a2);
+    pool.release(b);
+    CHECK(pool.stats().used == 0 && pool.stats().peak == 2);
+
+    // документ больше слота - из кучи, даже когда пул свободен
+    char *big = pool.lease(EMBUI_FRAMEPOOL_SIZE + 1);
+    CHECK(big != nullptr);
+    CHECK(pool.stats().misses == 3 && pool.stats().used == 0);
+    pool.release(big);
+
+    pool.release(nullptr);
+    CHECK(pool.stats().hits == 3);
+
+    // документ над буфером слота
+    char *buf = pool.lease(EMBUI_FRAMEPOOL_SIZE);
+    {
+        FrameDocument doc(buf, EMBUI_FRAMEPOOL_SIZE);
+        CHECK(doc.capacity() == EMBUI_FRAMEPOOL_SIZE && doc.data() == buf);
+    }
+    pool.release(buf);
+}
+
+/**
+ * Interface на каждое событие: буфер документа из пула против выделения из кучи, как было раньше
+ */
+static void bench(unsigned long iter){
+    static FramePool pool;
+    pool.begin();
+    double tp = host_bench(iter, [&](unsigned long){
+        char *p = pool.lease(EMBUI_FRAMEPOOL_SIZE);
+        KEEP(p);
+        pool.release(p);
+    });
+    double th = host_bench(iter, [&](unsigned long){
+        char *p = (char*)malloc(EMBUI_FRAMEPOOL_SIZE);
+        KEEP(p);
+        free(p);
+    });
+    printf("frame buffer: pool %5.1f ns, heap %5.1f ns per lease/release\n", tp, th);
+    CHECK(pool.stats().misses == 0);
+}
+
+int main(int argc, char **argv){
+    test_pool();
+    bench(host_iterations(argc, argv, 20000));
+    return host_result();
+}
@@ -0,0 +1,46 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+/**
+ * Общее для тестов и замеров на хосте: проверки и таймер
+ * каждая программа - отдельный тест ctest, код возврата - число проваленных проверок
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+
+static int host_failed = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        ++host_failed; \
+    } \
+} while (0)
+
+// в ctest замеры идут с малым числом повторов, полный прогон - аргументом командной строки
+static inline unsigned long host_iterations(int argc, char **argv, unsigned long dflt){
+    return argc > 1 ? strtoul(argv[1], nullptr, 10) : dflt;
+}
+
+// время выполнения fn() iter раз, нс на один вызов
+template <typename F> double host_bench(unsigned long iter, F fn){
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iter; i++) fn(i);
+    auto t1 = std::chrono::steady_clock::now();
+    return iter ? std::chrono::duration<double, std::nano>(t1 - t0).count() / iter : 0;
+}
+
+// не дать компилятору выбросить результат замеряемого вызова
+static volatile uintptr_t host_sink;
+#define KEEP(x) (host_sink += (uintptr_t)(x))
+
+static inline int host_result(){
+    if (host_failed) printf("%d check(s) failed\n", host_failed);
+    return host_failed;
+}
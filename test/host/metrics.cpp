@@ -0,0 +1,44 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * Metrics: текстовый формат Prometheus, метка с именем секции любой длины и с символами, требующими экранирования
+ */
+#include "hosttest.h"
+#include "metrics.h"
+#include <string>
+
+class StrPrint : public Print {
+  public:
+    std::string s;
+    size_t write(uint8_t c) override { s += (char)c; return 1; }
+};
+
+int main(){
+    StrPrint out;
+    Metrics::print(out, PSTR("m"), PSTR("help"), PSTR("counter"), 5);
+    CHECK(out.s == "# HELP m help\n# TYPE m counter\nm 5\n");
+
+    out.s.clear();
+    Metrics::print(out, PSTR("m"), nullptr, nullptr, 7, PSTR("section"), "eff_*");
+    CHECK(out.s == "m{section=\"eff_*\"} 7\n");
+
+    // имя длиннее прежнего буфера метки в 48 байт не обрезается
+    std::string name(100, 'x');
+    out.s.clear();
+    Metrics::print(out, PSTR("m"), nullptr, nullptr, 1, PSTR("section"), name.c_str());
+    CHECK(out.s == "m{section=\"" + name + "\"} 1\n");
+
+    out.s.clear();
+    Metrics::print(out, PSTR("m"), nullptr, nullptr, 2, PSTR("section"), "a\"b\\c\nd");
+    CHECK(out.s == "m{section=\"a\\\"b\\\\c\\nd\"} 2\n");
+
+    // счетчики фреймворка
+    metrics.inc(M_CFG_SAVES, 3);
+    out.s.clear();
+    metrics.printTo(out);
+    CHECK(out.s.find("\nembui_config_saves_total 3\n") != std::string::npos);
+    return host_result();
+}
@@ -0,0 +1,123 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * SectionIndex: поиск обработчика секции как в EmbUI::post()
+ * и замер против прежнего линейного прохода по LList для 10/100/500 обработчиков
+ */
+#include "hosttest.h"
+#include "sectionindex.h"
+#include "LList.h"
+
+typedef struct handler_t {
+    String name;
+    int id;
+} handler_t;
+
+// прежний разбор из EmbUI::post(): первый подходящий обработчик, символ перед '*' не сравнивается
+static handler_t *linear(LList<handler_t*> &list, const char *kname){
+    handler_t *section = nullptr;
+    for (int i = 0; !section && i < list.size(); i++) {
+        const char *sname = list[i]->name.c_str();
+        const char *mall = strchr(sname, '*');
+        unsigned len = mall ? mall - sname - 1 : strlen(kname);
+        if (strncmp(sname, kname, len) == 0) section = list[i];
+    }
+    return section;
+}
+
+static void test_lookup(){
+    handler_t h[] = {
+        {"wifi", 0}, {"wifi_ap", 1}, {"eff_*", 2}, {"eff_sp*", 3}, {"wifi", 4}, {"ctl_speed", 5}
+    };
+    SectionIndex<handler_t*> idx;
+    for (auto &x : h) idx.add(&x);
+
+    CHECK(idx.size() == 3);                     // второй "wifi" не добавляется
+    CHECK(idx.find("wifi") == &h[0]);           // первый зарегистрированный
+    CHECK(idx.find("wifi_ap") == &h[1]);
+    CHECK(idx.find("wif") == nullptr);          // точное имя - только полное совпадение
+    CHECK(idx.find("ctl_speed") == &h[5]);
+    CHECK(idx.find("eff_bright") == &h[2]);
+    CHECK(idx.find("eff") == &h[2]);            // "eff_*" - префикс "eff"
+    CHECK(idx.find("eff_speed") == &h[3]);      // самый длинный префикс
+    CHECK(idx.find("ef") == nullptr);
+    CHECK(idx.find("") == nullptr);
+
+    idx.clear();
+    CHECK(idx.size() == 0);
+    CHECK(idx.find("wifi") == nullptr);
+}
+
+static void test_grow(){
+    const int n = 1000;
+    handler_t *h = new handler_t[n];
+    SectionIndex<handler_t*> idx;
+    char name[16];
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "key_%d", i);
+        h[i].name = name;
+        h[i].id = i;
+        idx.add(&h[i]);
+    }
+    CHECK(idx.size() == n);
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "key_%d", i);
+        found += idx.find(name) == &h[i];
+    }
+    CHECK(found == n);
+    CHECK(idx.find("key_1000") == nullptr);
+    delete[] h;
+}
+
+/**
+ * n обработчиков с точными именами и два с '*', как в типичной прошивке;
+ * ключи из post: имена обработчиков вперемешку с ключами, которые уходят в wildcard
+ */
+static void bench(int n, unsigned long iter){
+    handler_t *h = new handler_t[n + 2];
+    LList<handler_t*> list;
+    SectionIndex<handler_t*> idx;
+    char name[16];
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "ctl_%03d", i);
+        h[i].name = name;
+        h[i].id = i;
+    }
+    h[n].name = "eff_*";
+    h[n + 1].name = "set_*";
+    for (int i = 0; i < n + 2; i++) {
+        list.add(&h[i]);
+        idx.add(&h[i]);
+    }
+
+    const int nkeys = 64;
+    char keys[nkeys][16];
+    for (int k = 0; k < nkeys; k++) {
+        if (k % 4 == 3) snprintf(keys[k], sizeof(keys[k]), "eff_param%d", k);
+        else snprintf(keys[k], sizeof(keys[k]), "ctl_%03d", (k * 37) % n);
+    }
+
+    int same = 0;
+    for (int k = 0; k < nkeys; k++) same += linear(list, keys[k]) == idx.find(keys[k]);
+    CHECK(same == nkeys);
+
+    double tl = host_bench(iter, [&](unsigned long i){ KEEP(linear(list, keys[i % nkeys])); });
+    double ti = host_bench(iter, [&](unsigned long i){ KEEP(idx.find(keys[i % nkeys])); });
+    printf("%4d handlers: linear %8.1f ns, index %6.1f ns per key\n", n, tl, ti);
+
+    list.clear();
+    delete[] h;
+}
+
+int main(int argc, char **argv){
+    test_lookup();
+    test_grow();
+
+    unsigned long iter = host_iterations(argc, argv, 20000);
+    for (int n : {10, 100, 500}) bench(n, iter);
+    return host_result();
+}
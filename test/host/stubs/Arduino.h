@@ -0,0 +1,118 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+/**
+ * Заглушка ядра Arduino для сборки частей фреймворка на хосте (test/host)
+ * только то, что нужно собираемым там модулям: PROGMEM-макросы, Print/Stream/String и время
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include <chrono>
+
+#define PROGMEM
+#define PGM_P               const char *
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_ptr(p)     (*(const void * const *)(p))
+#define strcmp_P            strcmp
+#define strncmp_P           strncmp
+#define strncpy_P           strncpy
+#define strlen_P            strlen
+#define memcpy_P            memcpy
+#define snprintf_P          snprintf
+#define sprintf_P           sprintf
+
+class __FlashStringHelper;
+#define FPSTR(p)            (reinterpret_cast<const __FlashStringHelper *>(p))
+#define F(s)                FPSTR(s)
+
+#define LOW                 0
+#define HIGH                1
+
+class Print {
+  public:
+    virtual ~Print(){}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t size){
+        size_t n = 0;
+        while (size--) n += write(*data++);
+        return n;
+    }
+    size_t write(const char *s){ return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const char *s){ return write(s); }
+    size_t print(const __FlashStringHelper *s){ return write((const char *)s); }
+    size_t print(char c){ return write((uint8_t)c); }
+    size_t print(int v){ return printf("%d", v); }
+    size_t print(unsigned int v){ return printf("%u", v); }
+    size_t print(long v){ return printf("%ld", v); }
+    size_t print(unsigned long v){ return printf("%lu", v); }
+    size_t println(const char *s = ""){ return print(s) + print('\n'); }
+    size_t println(const __FlashStringHelper *s){ return print(s) + print('\n'); }
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))){
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        return write((const uint8_t *)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+    }
+    template <typename... A> size_t printf_P(const char *fmt, A... a){ return printf(fmt, a...); }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    size_t readBytes(char *buf, size_t len){
+        size_t n = 0;
+        while (n < len && available() > 0) buf[n++] = read();
+        return n;
+    }
+    size_t readBytes(uint8_t *buf, size_t len){ return readBytes((char *)buf, len); }
+};
+
+class String {
+    std::string s;
+
+  public:
+    String(const char *p = ""): s(p ? p : "") {}
+    String(const __FlashStringHelper *p): s(p ? (const char *)p : "") {}
+    const char *c_str() const { return s.c_str(); }
+    size_t length() const { return s.size(); }
+    bool operator==(const char *p) const { return s == p; }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator!=(const char *p) const { return s != p; }
+    String &operator+=(const char *p){ s += p; return *this; }
+};
+
+// консоль хоста, LOG() в тестах собирается с -DEMBUI_DEBUG
+class HostSerial : public Print {
+  public:
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+static HostSerial Serial;
+
+// время: часы хоста, после host_settime() - заданное тестом
+inline bool &host_manualtime(){ static bool manual = false; return manual; }
+inline uint32_t &host_ms(){ static uint32_t ms = 0; return ms; }
+inline void host_settime(uint32_t ms){ host_manualtime() = true; host_ms() = ms; }
+
+inline unsigned long micros(){
+    using namespace std::chrono;
+    static const steady_clock::time_point t0 = steady_clock::now();
+    if (host_manualtime()) return (uint32_t)(host_ms() * 1000UL);
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+inline unsigned long millis(){ return host_manualtime() ? host_ms() : micros() / 1000; }
+inline void yield(){}
@@ -0,0 +1,89 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+/**
+ * Заглушка ArduinoJson: только типы, которые встречаются в интерфейсах модулей, собираемых на хосте.
+ * JsonObjectConst - плоский объект строк, этого хватает для ConfigStore::fromJson()
+ */
+#include "Arduino.h"
+#include <vector>
+#include <utility>
+
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+#define JSON_ARRAY_SIZE(n)  ((n) * 8)
+
+class JsonString {
+    const char *p;
+
+  public:
+    JsonString(const char *s): p(s) {}
+    const char *c_str() const { return p; }
+};
+
+class JsonVariantConst {
+    const char *p;
+
+  public:
+    JsonVariantConst(const char *s = nullptr): p(s) {}
+    template <typename T> T as() const { return p; }
+    bool isNull() const { return !p; }
+};
+
+class JsonPairConst {
+    const std::pair<std::string, std::string> *kv;
+
+  public:
+    JsonPairConst(const std::pair<std::string, std::string> *p): kv(p) {}
+    JsonString key() const { return kv->first.c_str(); }
+    JsonVariantConst value() const { return kv->second.c_str(); }
+};
+
+class JsonObjectConst {
+  public:
+    typedef std::vector<std::pair<std::string, std::string>> pairs_t;
+
+    class iterator {
+        pairs_t::const_iterator it;
+
+      public:
+        iterator(pairs_t::const_iterator i): it(i) {}
+        bool operator!=(const iterator &o) const { return it != o.it; }
+        iterator &operator++(){ ++it; return *this; }
+        JsonPairConst operator*() const { return &*it; }
+    };
+
+    JsonObjectConst(const pairs_t *p = nullptr): kv(p) {}
+    iterator begin() const { return pairs().begin(); }
+    iterator end() const { return pairs().end(); }
+
+  private:
+    const pairs_t *kv;
+    const pairs_t &pairs() const {
+        static const pairs_t empty;
+        return kv ? *kv : empty;
+    }
+};
+
+inline size_t serializeJson(JsonVariantConst, char *buf, size_t len){
+    if (len) buf[0] = '\0';
+    return 0;
+}
+
+/**
+ * документ поверх внешнего буфера, как в ArduinoJson: конструктор с буфером защищенный
+ */
+class JsonDocument {
+    char *pool;
+    size_t poolsize;
+
+  protected:
+    JsonDocument(char *buf, size_t capa): pool(buf), poolsize(capa) {}
+
+  public:
+    char *data() const { return pool; }
+    size_t capacity() const { return poolsize; }
+};
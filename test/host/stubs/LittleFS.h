@@ -0,0 +1,80 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+#pragma once
+
+/**
+ * Заглушка LittleFS: файлы в памяти, число записей считается, чтобы тесты видели, сколько раз трогали флеш
+ */
+#include "Arduino.h"
+#include <map>
+#include <memory>
+
+class HostFS {
+  public:
+    std::map<std::string, std::shared_ptr<std::string>> files;
+    unsigned long writes = 0;       // вызовов File::write()
+
+    std::shared_ptr<std::string> get(const char *path, bool create){
+        auto it = files.find(path);
+        if (it != files.end()) return it->second;
+        if (!create) return nullptr;
+        return files[path] = std::make_shared<std::string>();
+    }
+};
+
+class File : public Stream {
+    std::shared_ptr<std::string> data;
+    HostFS *fs = nullptr;
+    size_t pos = 0;
+
+  public:
+    File(){}
+    File(HostFS *f, std::shared_ptr<std::string> d, bool append): data(d), fs(f), pos(append ? d->size() : 0) {}
+    explicit operator bool() const { return (bool)data; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len) override {
+        if (!data) return 0;
+        ++fs->writes;
+        data->replace(pos, std::min(len, data->size() - pos), (const char *)buf, len);
+        pos += len;
+        return len;
+    }
+    int available() override { return data ? data->size() - pos : 0; }
+    int read() override { return available() > 0 ? (uint8_t)(*data)[pos++] : -1; }
+    size_t read(uint8_t *buf, size_t len){ return readBytes(buf, len); }
+    bool seek(size_t p){
+        if (!data || p > data->size()) return false;
+        pos = p;
+        return true;
+    }
+    size_t size() const { return data ? data->size() : 0; }
+    void close(){ data.reset(); }
+};
+
+class HostLittleFS : public HostFS {
+  public:
+    bool begin(){ return true; }
+    File open(const String &path, const char *mode){
+        auto d = get(path.c_str(), mode[0] != 'r');
+        if (!d) return File();
+        if (mode[0] == 'w') d->clear();
+        return File(this, d, mode[0] == 'a');
+    }
+    File open(const __FlashStringHelper *path, const char *mode){ return open(String(path), mode); }
+    bool exists(const String &path){ return files.count(path.c_str()); }
+    bool remove(const String &path){ return files.erase(path.c_str()); }
+    bool rename(const String &from, const String &to){
+        auto it = files.find(from.c_str());
+        if (it == files.end()) return false;
+        auto d = it->second;
+        files.erase(it);
+        files[to.c_str()] = d;
+        return true;
+    }
+};
+
+extern HostLittleFS LittleFS;
@@ -0,0 +1,86 @@
+// This framework originaly based on JeeUI2 lib used under MIT License Copyright (c) 2019 Marsel Akhkamov
+// then re-written and named by (c) 2020 Anton Zolotarev (obliterator) (https://github.com/anton-zolotarev)
+// also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
+// and others people
+
+/**
+ * TimerWheel: таймер не срабатывает раньше заданного срока и опаздывает не больше чем на шаг колеса,
+ * где бы внутри шага его ни завели; время ведет тест, run() вызывается каждую миллисекунду, как из loop()
+ */
+#include "hosttest.h"
+#include "timerwheel.h"
+
+static uint32_t now = 0;
+
+static void advance(uint32_t ms){
+    while (ms--) {
+        host_settime(++now);
+        timerwheel.run();
+    }
+}
+
+int main(){
+    host_settime(now);
+    timerwheel.run();
+
+    // таймер заведен в конце шага: прежнее округление от начала шага давало срабатывание на шаг раньше
+    {
+        TwTimer t;
+        uint32_t fired = 0;
+        advance(EMBUI_TW_TICK - 1);
+        uint32_t start = now;
+        t.once(EMBUI_TW_TICK, [&](){ fired = now; });
+        advance(3 * EMBUI_TW_TICK);
+        CHECK(fired >= start + EMBUI_TW_TICK && fired < start + 2 * EMBUI_TW_TICK);
+    }
+
+    // любой момент внутри шага и разные сроки, включая верхние уровни колеса
+    {
+        int early = 0, late = 0;
+        const uint32_t delays[] = {0, 1, 9, 10, 11, 25, 640, 655, 5000, 41000};
+        for (uint32_t phase = 0; phase < EMBUI_TW_TICK; phase++) {
+            for (uint32_t ms : delays) {
+                TwTimer t;
+                uint32_t fired = 0;
+                advance(phase);
+                uint32_t start = now;
+                t.once(ms, [&](){ fired = now; });
+                while (!fired && now - start < ms + 4 * EMBUI_TW_TICK) advance(1);
+                early += !fired || fired < start + ms;
+                late += fired >= start + ms + EMBUI_TW_TICK;
+            }
+        }
+        CHECK(early == 0);
+        CHECK(late == 0);
+    }
+
+    // loop() стоял: срок считается от millis() на момент постановки, а не от последнего разобранного шага
+    {
+        TwTimer t;
+        uint32_t fired = 0;
+        now += 3 * EMBUI_TW_TICK + 7;
+        host_settime(now);
+        uint32_t start = now;
+        t.once(2 * EMBUI_TW_TICK, [&](){ fired = now; });
+        advance(5 * EMBUI_TW_TICK);
+        CHECK(fired >= start + 2 * EMBUI_TW_TICK && fired < start + 3 * EMBUI_TW_TICK);
+    }
+
+    // периодический таймер: первый раз не раньше периода, next() - оценка снизу
+    {
+        TwTimer t;
+        int calls = 0;
+        uint32_t first = 0;
+        uint32_t start = now;
+        t.every(100, [&](){ if (!calls++) first = now; });
+        uint32_t est = timerwheel.next();
+        advance(1000 + EMBUI_TW_TICK);
+        CHECK(calls == 10);
+        CHECK(first >= start + 100 && est != TW_NONE && est <= first - start);
+        t.detach();
+        CHECK(timerwheel.next() == TW_NONE);
+    }
+
+    CHECK(timerwheel.size() == 0);
+    return host_result();
+}